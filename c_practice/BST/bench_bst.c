@@ -0,0 +1,159 @@
+/*
+ * This file contains executable code for timing the BST on keys that arrive
+ * in sorted order, the worst case for a plain BST.  It inserts sequential
+ * keys into a balanced tree and into a plain one and reports the height of
+ * each tree and the latency of lookups.  A plain tree takes quadratic time
+ * to build from sorted keys, so it gets fewer of them.
+ *
+ * It then times range sums over narrow and wide ranges, on the balanced tree
+ * and on a plain tree built from the same keys in random order, against a
+ * range sum that visits every node the way the old one did.  Run it as
+ * `./bench_bst [balanced_keys] [plain_keys]`.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "bst.h"
+
+/*
+ * This function returns the current time in seconds from a monotonic clock.
+ */
+double now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * This function inserts the keys 0 to n - 1 in order into a tree, then looks
+ * up `lookups` random keys and prints the timings.
+ */
+void bench_sorted(const char* name, struct bst* bst, int n, int lookups) {
+  static int value = 1;
+  double start = now();
+  for (int i = 0; i < n; i++) {
+    bst_insert(bst, i, &value);
+  }
+  double insert = now() - start;
+
+  unsigned int x = 2463534242u;
+  int found = 0;
+  start = now();
+  for (int i = 0; i < lookups; i++) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    found += bst_get(bst, (int)(x % n)) != NULL;
+  }
+  double lookup = now() - start;
+
+  printf("  %-10s %9d keys   height %9d   insert %8.1f ns/key   lookup %10.1f ns   found %d/%d\n",
+    name, n, bst_height(bst), insert / n * 1e9, lookup / lookups * 1e9, found, lookups);
+}
+
+/*
+ * This works like the range sum did before nodes kept the sums of their
+ * subtrees: it visits every node, whatever the range, and adds up in an int.
+ */
+int range_sum_all_nodes(struct bst* bst, int lower, int upper) {
+  struct bst_iterator* iter = bst_iterator_create(bst);
+  int sum = 0;
+  while (bst_iterator_has_next(iter)) {
+    void* value;
+    int key = bst_iterator_next(iter, &value);
+    if (key >= lower && key <= upper) {
+      sum += key;
+    }
+  }
+  bst_iterator_free(iter);
+  return sum;
+}
+
+/*
+ * This function times range sums of the given width starting at random keys
+ * of a tree holding the keys 0 to n - 1.  The old code gets far fewer
+ * queries since each of them walks the whole tree.  It also counts how many
+ * of the old results differ from the new ones, which happens when the int
+ * sum overflows.
+ */
+void bench_range(const char* tree, const char* name, struct bst* bst, int n,
+    int width, int queries, int old_queries) {
+  unsigned int x = 88172645u;
+  long long check = 0;
+  double start = now();
+  for (int i = 0; i < queries; i++) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    int lower = (int)(x % (unsigned int)(n - width + 1));
+    check += bst_range_sum(bst, lower, lower + width - 1);
+  }
+  double fast = now() - start;
+
+  int wrong = 0;
+  start = now();
+  for (int i = 0; i < old_queries; i++) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    int lower = (int)(x % (unsigned int)(n - width + 1));
+    wrong += range_sum_all_nodes(bst, lower, lower + width - 1)
+      != bst_range_sum(bst, lower, lower + width - 1);
+  }
+  double old = now() - start;
+
+  printf("  %-8s %-6s width %9d   pruned %9.1f ns/query   all nodes %12.1f ns/query   %8.0fx   old sum wrong %d/%d   (checksum %lld)\n",
+    tree, name, width, fast / queries * 1e9, old / old_queries * 1e9,
+    (old / old_queries) / (fast / queries), wrong, old_queries, check);
+}
+
+int main(int argc, char** argv) {
+  int n = argc > 1 ? atoi(argv[1]) : 10000000;
+  int plain_n = argc > 2 ? atoi(argv[2]) : 20000;
+
+  printf("== Inserting sorted keys...\n");
+  struct bst* bst = bst_create_balanced();
+  bench_sorted("balanced", bst, n, 1000000);
+
+  struct bst* plain = bst_create();
+  bench_sorted("plain", plain, plain_n, 10000);
+  bst_free(plain);
+
+  printf("\n== Range sums over %d keys...\n", n);
+  bench_range("balanced", "narrow", bst, n, 100, 1000000, 5);
+  bench_range("balanced", "wide", bst, n, n / 2, 1000000, 5);
+  bst_free(bst);
+
+  /*
+   * A plain tree built from shuffled keys is about as deep as a balanced one
+   * on average, but is not kept that way.
+   */
+  int* keys = malloc(n * sizeof(int));
+  for (int i = 0; i < n; i++) {
+    keys[i] = i;
+  }
+  unsigned int x = 2463534242u;
+  for (int i = n - 1; i > 0; i--) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    int j = x % (unsigned int)(i + 1);
+    int tmp = keys[i];
+    keys[i] = keys[j];
+    keys[j] = tmp;
+  }
+  bst = bst_create();
+  for (int i = 0; i < n; i++) {
+    bst_insert(bst, keys[i], NULL);
+  }
+  free(keys);
+  bench_range("shuffled", "narrow", bst, n, 100, 1000000, 5);
+  bench_range("shuffled", "wide", bst, n, n / 2, 1000000, 5);
+  bst_free(bst);
+
+  return 0;
+}
@@ -23,26 +23,51 @@
  * fields representing the data stored at this node.  The `key` field is an
  * integer value that should be used as an identifier for the data in this
  * node.  Nodes in the BST should be ordered based on this `key` field.  The
- * `value` field stores data associated with the key.
- *
- * You should not modify this structure.
+ * `value` field stores data associated with the key.  In a balanced tree the
+ * `height` field holds the height of the subtree rooted at this node.  `size`
+ * counts the nodes of the subtree rooted at this node, itself included, and
+ * `sum` adds up their keys, in every tree.  `sum` is 64 bits wide so it
+ * cannot overflow.  On 64-bit machines these fields take a node from 32 to
+ * 48 bytes, 4 of which are padding in front of `sum`.
  */
 struct bst_node {
   int key;
+  int height;
+  int size;
+  long long sum;
   void* value;
   struct bst_node* left;
   struct bst_node* right;
 };
 
 
+/*
+ * Nodes are not malloc'ed one at a time but carved one after the other out
+ * of chunks of this many bytes, which the tree keeps in a singly-linked list.
+ */
+#define BST_CHUNK_BYTES (1 << 16)
+
+struct bst_chunk {
+  struct bst_chunk* next;
+  struct bst_node nodes[];
+};
+
 /*
  * This structure represents an entire BST.  It specifically contains a
- * reference to the root node of the tree.
- *
- * You should not modify this structure.
+ * reference to the root node of the tree.  `balanced` is set for trees
+ * created with bst_create_balanced(), which rebalance themselves as AVL
+ * trees on every insert and remove.  The remaining fields make up the node
+ * arena: `bump` points at the next never-used node of the newest chunk and
+ * `bump_left` counts how many such nodes remain.  Removed nodes are chained
+ * through their `right` field on `free_list` and handed out again first.
  */
 struct bst {
   struct bst_node* root;
+  int balanced;
+  struct bst_chunk* chunks;
+  struct bst_node* bump;
+  int bump_left;
+  struct bst_node* free_list;
 };
 
 /*
@@ -52,22 +77,204 @@ struct bst {
 struct bst* bst_create() {
     struct bst* bst = malloc(sizeof(struct bst));
     bst->root = NULL;
+    bst->balanced = 0;
+    bst->chunks = NULL;
+    bst->bump = NULL;
+    bst->bump_left = 0;
+    bst->free_list = NULL;
+
+    return bst;
+}
+
+/*
+ * This function allocates and initializes a new, empty, balanced BST and
+ * returns a pointer to it.  A balanced tree supports the whole bst.h
+ * interface, but it rotates nodes on every insert and remove so that the
+ * heights of the two subtrees of any node differ by at most one (an AVL
+ * tree).  Its height stays below 1.45 * log2(n) even when the keys arrive
+ * sorted, where a plain tree would degrade into a list.
+ */
+struct bst* bst_create_balanced() {
+    struct bst* bst = bst_create();
+    bst->balanced = 1;
 
     return bst;
 }
 
 /*====================================================================================================*/
-//helper functions for free function
+//helper functions for balanced trees, every node keeps the height of its
+//subtree so a rotation can tell when one side has grown too tall
+
+int node_height(struct bst_node* node){
+    return node ? node->height : -1;
+}
 
-void bst_node_free(struct bst_node* node){
-    if(node){
-        bst_node_free(node->left);
-        bst_node_free(node->right);
-        free(node);
+int node_size(struct bst_node* node){
+    return node ? node->size : 0;
+}
+
+long long node_sum(struct bst_node* node){
+    return node ? node->sum : 0;
+}
+
+// recomputes the height, size and sum of a node from its children
+void node_update(struct bst_node* node){
+    int lh = node_height(node->left);
+    int rh = node_height(node->right);
+    node->height = (lh > rh ? lh : rh) + 1;
+    node->size = node_size(node->left) + node_size(node->right) + 1;
+    node->sum = node_sum(node->left) + node_sum(node->right) + node->key;
+}
+
+// lifts the left child of node into its place and returns it
+struct bst_node* rotate_right(struct bst_node* node){
+    struct bst_node* left = node->left;
+    node->left = left->right;
+    left->right = node;
+    node_update(node);
+    node_update(left);
+    return left;
+}
+
+// lifts the right child of node into its place and returns it
+struct bst_node* rotate_left(struct bst_node* node){
+    struct bst_node* right = node->right;
+    node->right = right->left;
+    right->left = node;
+    node_update(node);
+    node_update(right);
+    return right;
+}
+
+// restores the AVL property at node after one of its subtrees changed height
+// by one, returns the node now at the top of the subtree
+struct bst_node* rebalance(struct bst_node* node){
+    node_update(node);
+    int balance = node_height(node->left) - node_height(node->right);
+    if (balance > 1){
+        // the left-right case needs a double rotation
+        if (node_height(node->left->left) < node_height(node->left->right)){
+            node->left = rotate_left(node->left);
+        }
+        return rotate_right(node);
+    }
+    if (balance < -1){
+        if (node_height(node->right->right) < node_height(node->right->left)){
+            node->right = rotate_right(node->right);
+        }
+        return rotate_left(node);
     }
+    return node;
+}
 
+/*====================================================================================================*/
+//helper functions shared by insert and the traversals, no operation recurses
+//or needs memory that grows with the depth of the tree, so a tree may be as
+//deep as memory allows without touching the thread stack
+
+/*
+ * Longest root-to-node path a balanced tree can have.  An AVL tree of height
+ * h holds at least fib(h + 3) - 1 nodes, so no tree with an int number of
+ * nodes gets near it, and insert and remove can remember their path in a
+ * fixed array.
+ */
+#define BST_MAX_HEIGHT 64
+
+// takes a node without children from the tree's arena, removed nodes are
+// reused first, then the newest chunk is used up, then a new one is added
+struct bst_node* node_create(struct bst* bst, int key, void* value){
+    struct bst_node *node;
+    if (bst->free_list){
+        node = bst->free_list;
+        bst->free_list = node->right;
+    }else{
+        if (bst->bump_left == 0){
+            struct bst_chunk *chunk = malloc(BST_CHUNK_BYTES);
+            assert(chunk);
+            chunk->next = bst->chunks;
+            bst->chunks = chunk;
+            bst->bump = chunk->nodes;
+            bst->bump_left = (BST_CHUNK_BYTES - sizeof(struct bst_chunk)) / sizeof(struct bst_node);
+        }
+        node = bst->bump++;
+        bst->bump_left--;
+    }
+    node->key = key;
+    node->height = 0;
+    node->size = 1;
+    node->sum = key;
+    node->value = value;
+    node->left = NULL;
+    node->right = NULL;
+    return node;
+}
+
+// hands a removed node back to the tree's arena
+void node_release(struct bst* bst, struct bst_node* node){
+    node->right = bst->free_list;
+    bst->free_list = node;
 }
 
+// walks a subtree in order without a stack or any other memory that grows
+// with the tree (a Morris traversal): before going down into the left
+// subtree of a node, the rightmost node of that subtree, its in-order
+// predecessor, has its empty right link pointed back at the node, and that
+// thread is followed back up and removed again once the subtree is done.
+// The tree is changed while the walk runs, but every link is restored by the
+// time it returns.  Along the way it keeps the depth of the current node and
+// the sum of the keys from the root down to it, both of which go stale when
+// a thread is followed, and get corrected from the number and the keys of
+// the nodes between the node and its predecessor.  It reports the height of
+// the subtree and whether some path from the root to a leaf sums to target.
+void bst_node_walk(struct bst_node* node, long long target, int* height, int* found){
+    int depth = 0;
+    long long path = node ? node->key : 0;
+    *height = -1;
+    *found = 0;
+    while(node){
+        if(node->left == NULL){
+            // a right link that is a thread is only known to be one when
+            // it is followed, so such leaves are checked below
+            if(node->right == NULL && path == target){
+                *found = 1;
+            }
+        }else{
+            struct bst_node *pre = node->left;
+            int steps = 0;
+            long long keys = pre->key;
+            while(pre->right && pre->right != node){
+                pre = pre->right;
+                steps++;
+                keys += pre->key;
+            }
+            if(pre->right == NULL){
+                // first time here, thread the predecessor and go left
+                pre->right = node;
+                node = node->left;
+                depth++;
+                path += node->key;
+                continue;
+            }
+            // back up the thread from pre, which is a leaf if it had no
+            // left child since its right link was free for the thread
+            pre->right = NULL;
+            path -= node->key;
+            if(pre->left == NULL && path == target){
+                *found = 1;
+            }
+            depth -= steps + 2;
+            path -= keys;
+        }
+        if(depth > *height){
+            *height = depth;
+        }
+        node = node->right;
+        if(node){
+            depth++;
+            path += node->key;
+        }
+    }
+}
 
 /*====================================================================================================*/
    
@@ -82,7 +289,13 @@ void bst_node_free(struct bst_node* node){
  */
 void bst_free(struct bst* bst) {
     assert(bst);
-    bst_node_free(bst->root);
+    // every node lives in one of the chunks, so the tree is never walked
+    struct bst_chunk *next, *chunk = bst->chunks;
+    while(chunk){
+        next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
     free(bst);
 
 
@@ -90,17 +303,6 @@ void bst_free(struct bst* bst) {
     return;
 }
 
-/*====================================================================================================*/
-//helper function for size function
-
-int bst_node_size(struct bst_node *node){
-    if(node == NULL){return 0;}
-    else{
-        int lsize = bst_node_size(node->left);
-        int rsize = bst_node_size(node->right);
-        return lsize+rsize+1;
-    }
-}
 /*====================================================================================================*/
 
 /*
@@ -111,29 +313,42 @@ int bst_node_size(struct bst_node *node){
  *   bst - the BST whose elements are to be counted.  May not be NULL.
  */
 int bst_size(struct bst* bst) {
-    return bst_node_size(bst->root);
+    // every node counts the nodes below it, the root counts the whole tree
+    return node_size(bst->root);
 }
 
 /*====================================================================================================*/
 //helper funtion for the insert function
 
-struct bst_node* bst_node_insert(struct bst_node *node, int key, void* value){
-    if(node == NULL){
-        node = malloc(sizeof(struct bst_node));
-        node->key = key;
-        node->value = value;
-        node->left = NULL;
-        node->right = NULL;
-        return node;
-    }
-    if(node){
-        if(node->key <= key){
-            node->right = bst_node_insert(node->right, key, value);
+// walks down from the link holding the root to the empty link where the key
+// belongs and hangs a new node there, every node passed on the way gains it
+// as a descendant and adds its key to the sum, in a balanced tree every node
+// on the path is then rebalanced from the bottom up
+void bst_node_insert(struct bst* bst, struct bst_node **link, int key, void* value){
+    struct bst_node **path[BST_MAX_HEIGHT];
+    int depth = 0;
+
+    while(*link){
+        (*link)->size++;
+        (*link)->sum += key;
+        if(bst->balanced){
+            assert(depth < BST_MAX_HEIGHT);
+            path[depth++] = link;
+        }
+        if((*link)->key <= key){
+            link = &(*link)->right;
         }else{
-            node->left = bst_node_insert(node->left, key, value);
+            link = &(*link)->left;
         }
     }
-    return node;
+    *link = node_create(bst, key, value);
+
+    // rotations only change what a link points to, the links of the nodes
+    // further up stay where they are
+    while(depth > 0){
+        link = path[--depth];
+        *link = rebalance(*link);
+    }
 }
 /*====================================================================================================*/
 
@@ -153,7 +368,7 @@ struct bst_node* bst_node_insert(struct bst_node *node, int key, void* value){
  *     which means that a pointer of any type can be passed.
  */
 void bst_insert(struct bst* bst, int key, void* value) {
-    bst->root = bst_node_insert(bst->root, key, value);
+    bst_node_insert(bst, &bst->root, key, value);
     return;
 }
 
@@ -161,42 +376,82 @@ void bst_insert(struct bst* bst, int key, void* value) {
 /*====================================================================================================*/
 // helper function for the remove function
 
-struct bst_node* bst_node_remove(struct bst_node *node, int key){
-    if (node == NULL){  return NULL;}
-        
-    if(node->key == key){
-        //if key has no children
-        if((node->left == NULL) && (node->right == NULL)){
-            free(node);
-            return NULL;
-            
-        // if key has one child
-        // set left and right to NULL
-        }else if((node->left == NULL) ^ (node->right == NULL)){
-            struct bst_node *temp = node->left ? node->left:node->right;
-            free(node); 
-            return temp;
-        // has children
+// walks down to the link holding the first node with the key and unlinks
+// the node, keeping the sizes and sums of the nodes above it right, a node
+// with two children takes over the key and value of its in-order successor
+// and the successor is unlinked instead, in a balanced tree every node on
+// the path is then rebalanced from the bottom up
+void bst_node_remove(struct bst* bst, struct bst_node **link, int key){
+    struct bst_node **path[BST_MAX_HEIGHT];
+    int depth = 0;
+
+    // a missing key changes nothing, so look for it before any size or sum
+    // on the way down is decremented
+    struct bst_node *node = *link;
+    while(node && node->key != key){
+        if(node->key <= key){
+            node = node->right;
         }else{
-            struct bst_node *temp = node->right;
-            
-            while(temp->left){     
-            
-                temp = temp->left;
-            }
-            
-            node->key = temp->key;
-            node->value = temp->value;
-            node->right = bst_node_remove(node->right, temp->key);
+            node = node->left;
+        }
+    }
+    if (node == NULL){  return;}
+
+    // every node passed on the way down loses one descendant and its key
+    while((*link)->key != key){
+        (*link)->size--;
+        (*link)->sum -= key;
+        if(bst->balanced){
+            assert(depth < BST_MAX_HEIGHT);
+            path[depth++] = link;
+        }
+        if((*link)->key <= key){
+            link = &(*link)->right;
+        }else{
+            link = &(*link)->left;
         }
     }
-    if(node->key <= key){
-        node->right = bst_node_remove(node->right, key);
+    node = *link;
+
+    if(node->left && node->right){
+        // the successor is the leftmost node of the right subtree, its key
+        // moves up into node, so node loses the removed key and the nodes on
+        // the way down to the successor lose the successor's key
+        struct bst_node *min = node->right;
+        while(min->left){
+            min = min->left;
+        }
+        struct bst_node **succ = &node->right;
+        node->size--;
+        node->sum -= key;
+        if(bst->balanced){
+            assert(depth < BST_MAX_HEIGHT);
+            path[depth++] = link;
+        }
+        while((*succ)->left){
+            (*succ)->size--;
+            (*succ)->sum -= min->key;
+            if(bst->balanced){
+                assert(depth < BST_MAX_HEIGHT);
+                path[depth++] = succ;
+            }
+            succ = &(*succ)->left;
+        }
+        struct bst_node *temp = *succ;
+        node->key = temp->key;
+        node->value = temp->value;
+        *succ = temp->right;
+        node_release(bst, temp);
     }else{
-        node->left = bst_node_remove(node->left, key);
+        // no child or one child, the child takes the node's place
+        *link = node->left ? node->left:node->right;
+        node_release(bst, node);
+    }
+
+    while(depth > 0){
+        link = path[--depth];
+        *link = rebalance(*link);
     }
-    
-    return node;
 }
 /*====================================================================================================*/
 
@@ -212,7 +467,7 @@ struct bst_node* bst_node_remove(struct bst_node *node, int key){
  *   key - the key of the key/value pair to be removed from the BST.
  */
 void bst_remove(struct bst* bst, int key) {
-    bst->root = bst_node_remove(bst->root, key);
+    bst_node_remove(bst, &bst->root, key);
     return;
 }
 
@@ -221,17 +476,17 @@ void bst_remove(struct bst* bst, int key) {
 //helper function for bst_get
 
 void *bst_node_get(struct bst_node* node, int key){
-    if(node == NULL){
-        return NULL;
-    }if (node->key == key){
-        return node->value;
-    }
-    if(node->key <= key){
-        return bst_node_get(node->right, key);
-    }else{
-        return bst_node_get(node->left, key);
+    while(node){
+        if (node->key == key){
+            return node->value;
+        }
+        if(node->key <= key){
+            node = node->right;
+        }else{
+            node = node->left;
+        }
     }
-    
+    return NULL;
 }
 
 /*====================================================================================================*/
@@ -267,17 +522,12 @@ void* bst_get(struct bst* bst, int key) {
 /*====================================================================================================*/
 // helper function for getting height of bst
 
+// the height is the depth of the deepest node bst_node_walk() passes
 int height(struct bst_node *node){
-    if(node == NULL){ return -1;}
-    
-    int LN = height(node->left);
-    int RN = height(node->right);
-    if (node->left > node->right){
-        return LN+1;
-    }
-    return RN+1;
+    int max, found;
+    bst_node_walk(node, 0, &max, &found);
+    return max;
 }
-
 /*====================================================================================================*/
 
 /*
@@ -293,18 +543,22 @@ int height(struct bst_node *node){
  *   Should return the height of bst.
  */
 int bst_height(struct bst* bst) {
-
-     return height(bst->root);
+    // a balanced tree keeps the height of every subtree up to date
+    if (bst->balanced){
+        return node_height(bst->root);
+    }
+    return height(bst->root);
 }
 
 /*====================================================================================================*/
 //helper function to path sum function
-int bst_node_path_sum(struct bst_node* node, int sum){
-    if (node == NULL){ return 0;}
-    
-    if(sum == node->key && !node->left && !node->right){return 1;}
 
-    return bst_node_path_sum(node->left, sum-node->key) || bst_node_path_sum(node->right, sum-node->key);
+// bst_node_walk() checks the sum of every root-to-leaf path, it cannot stop
+// at the first match since its threads have to be removed again
+int bst_node_path_sum(struct bst_node* node, int sum){
+    int max, found;
+    bst_node_walk(node, sum, &max, &found);
+    return found;
 }
 /*====================================================================================================*/
 
@@ -332,24 +586,20 @@ int bst_path_sum(struct bst* bst, int sum) {
 /*====================================================================================================*/
 //this is a helper function for bst range sum
 
-int bst_node_range_sum(struct bst_node* node, int lower, int upper){
-
-    if (node == NULL){
-        return 0; 
-    }
-    
-
-    int sum = 0;
-
-    sum += bst_node_range_sum(node->left, lower, upper);
-
-    if (node->key >= lower && node->key <= upper){
-        sum += node->key;
+// sums the keys below a bound, or up to and including it when inclusive is
+// set, every node whose key is in takes the sum of its left subtree along
+// and the walk goes right, otherwise its right subtree is out and the walk
+// goes left, so only one path is walked
+long long bst_node_prefix_sum(struct bst_node* node, int bound, int inclusive){
+    long long sum = 0;
+    while(node){
+        if(node->key < bound || (inclusive && node->key == bound)){
+            sum += node_sum(node->left) + node->key;
+            node = node->right;
+        }else{
+            node = node->left;
+        }
     }
-
-    sum += bst_node_range_sum(node->right, lower, upper);
-    
-
     return sum;
 }
 /*====================================================================================================*/
@@ -370,9 +620,77 @@ int bst_node_range_sum(struct bst_node* node, int lower, int upper){
  *
  * Return:
  *   Should return the sum of all keys in `bst` between `lower` and `upper`.
+ *   The sum is computed as the sum up to `upper` minus the sum below `lower`
+ *   from the subtree sums kept in the nodes, which takes two walks down from
+ *   the root.
+ */
+long long bst_range_sum(struct bst* bst, int lower, int upper) {
+    if (lower > upper){
+        return 0;
+    }
+    return bst_node_prefix_sum(bst->root, upper, 1)
+        - bst_node_prefix_sum(bst->root, lower, 0);
+}
+
+/*====================================================================================================*/
+
+/*
+ * This function returns the rank of a key in a given BST, the number of keys
+ * in the BST that are smaller than it.  The key itself does not have to be
+ * stored in the BST.  Every step down skips the left subtree of a node whose
+ * size is known, so only one path from the root is walked.
+ *
+ * Params:
+ *   bst - the BST within which to rank the key.  May not be NULL.
+ *   key - the key to be ranked.
+ *
+ * Return:
+ *   Should return the number of keys in `bst` less than `key`, a number
+ *   between 0 and bst_size(bst).
+ */
+int bst_rank(struct bst* bst, int key) {
+    assert(bst);
+    struct bst_node *node = bst->root;
+    int rank = 0;
+    while(node){
+        if(node->key < key){
+            rank += node_size(node->left) + 1;
+            node = node->right;
+        }else{
+            node = node->left;
+        }
+    }
+    return rank;
+}
+
+/*
+ * This function selects the key of a given rank in a given BST, the k-th
+ * smallest key counting from 0, so that bst_select(bst, 0) is the smallest
+ * key and bst_select(bst, bst_size(bst) - 1) the largest.  Like bst_rank() it
+ * walks a single path from the root.
+ *
+ * Params:
+ *   bst - the BST within which to select a key.  May not be NULL.
+ *   k - the rank of the key to be selected.  Must be at least 0 and less than
+ *     bst_size(bst).
+ *
+ * Return:
+ *   Should return the key in `bst` that has exactly `k` keys before it in
+ *   order.  Equal keys are ordered as bst_iterator_next() returns them.
  */
-int bst_range_sum(struct bst* bst, int lower, int upper) {
-    return bst_node_range_sum(bst->root, lower, upper);
+int bst_select(struct bst* bst, int k) {
+    assert(bst);
+    assert(k >= 0 && k < bst_size(bst));
+    struct bst_node *node = bst->root;
+    while(k != node_size(node->left)){
+        if(k < node_size(node->left)){
+            node = node->left;
+        }else{
+            k -= node_size(node->left) + 1;
+            node = node->right;
+        }
+    }
+    return node->key;
 }
 
 
@@ -396,10 +714,11 @@ struct bst_iterator {
 /*====================================================================================================*/
 // helper function for create function
 
+// pushes node and its chain of left children, the smallest key ends on top
 struct bst_node* node_iterator_create(struct bst_node* node, struct bst_iterator* iterator){
-    if(node){ 
+    while(node){
         stack_push(iterator->stack, node);
-        return node_iterator_create(node->left, iterator);
+        node = node->left;
     }
     return node;
 }
@@ -455,10 +774,7 @@ int bst_iterator_has_next(struct bst_iterator* iter) {
 //helper function for next function
 
 struct bst_iterator* iter_next(struct bst_node* node, struct bst_iterator* iter){
-    if(node){
-        stack_push(iter->stack, node);
-        return iter_next(node->left, iter);
-    }
+    node_iterator_create(node, iter);
     return iter;
 }
 
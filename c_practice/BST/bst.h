@@ -18,6 +18,7 @@ struct bst;
  * documentation about each of these functions.
  */
 struct bst* bst_create();
+struct bst* bst_create_balanced();
 void bst_free(struct bst* bst);
 int bst_size(struct bst* bst);
 void bst_insert(struct bst* bst, int key, void* value);
@@ -30,7 +31,9 @@ void* bst_get(struct bst* bst, int key);
 
 int bst_height(struct bst* bst);
 int bst_path_sum(struct bst* bst, int sum);
-int bst_range_sum(struct bst* bst, int lower, int upper);
+long long bst_range_sum(struct bst* bst, int lower, int upper);
+int bst_rank(struct bst* bst, int key);
+int bst_select(struct bst* bst, int k);
 
 /*
  * Structure used to represent a binary search tree iterator.
@@ -82,8 +82,12 @@ int main(int argc, char** argv) {
    * words, for any given key, we'll be able to verify that the tree contains
    * the correct value by comparing key == *value.
    */
-  printf("== Creating BST...\n");
-  struct bst* bst = bst_create();
+  /*
+   * A balanced tree can be tested instead with `./test_bst balanced`.
+   */
+  int balanced = argc > 1 && strcmp(argv[1], "balanced") == 0;
+  printf("== Creating %sBST...\n", balanced ? "balanced " : "");
+  struct bst* bst = balanced ? bst_create_balanced() : bst_create();
   printf("\n== Inserting %d values into BST...\n", NUM_TEST_DATA);
   for (int i = 0; i < NUM_TEST_DATA; i++) {
     bst_insert(bst, TEST_DATA[i], (void*)&TEST_DATA[i]);
@@ -174,10 +178,27 @@ int main(int argc, char** argv) {
     int lower = RANGE_SUMS[i][0];
     int upper = RANGE_SUMS[i][1];
     int sum = RANGE_SUMS[i][2];
-    printf("  -- bst_range_sum(%d, %d): %d (expected %d)\n", lower, upper,
+    printf("  -- bst_range_sum(%d, %d): %lld (expected %d)\n", lower, upper,
       bst_range_sum(bst, lower, upper), sum);
   }
 
+  /*
+   * Test rank and select.  The keys are distinct, so the rank of every key is
+   * its index in sorted order, and selecting that index gives the key back.
+   */
+  printf("\n== Checking ranks and selects in the BST:\n");
+  int num_bad_ranks = 0;
+  for (int i = 0; i < NUM_TEST_DATA; i++) {
+    if (bst_rank(bst, sorted[i]) != i || bst_select(bst, i) != sorted[i]) {
+      num_bad_ranks++;
+      printf("  -- rank %2d: bst_rank(%3d): %2d, bst_select(%2d): %3d\n", i,
+        sorted[i], bst_rank(bst, sorted[i]), i, bst_select(bst, i));
+    }
+  }
+  printf("  -- found %d wrong ranks or selects (expected 0)\n", num_bad_ranks);
+  printf("  -- bst_rank(%d): %d (expected %d)\n", sorted[NUM_TEST_DATA - 1] + 1,
+    bst_rank(bst, sorted[NUM_TEST_DATA - 1] + 1), NUM_TEST_DATA);
+
 
   /*
    * Test removing keys from the BST.  After removing each key, make sure
@@ -202,6 +223,21 @@ int main(int argc, char** argv) {
   printf("\n== Checking correct value from bst_size(): %d (expected %d)\n",
     bst_size(bst), NUM_TEST_DATA - NUM_DATA_TO_REMOVE);
 
+  /*
+   * Make sure ranks and selects skip the removed keys.
+   */
+  num_bad_ranks = 0;
+  for (int i = 0, k = 0; i < NUM_TEST_DATA; i++) {
+    if (k < NUM_DATA_TO_REMOVE && sorted[i] == TEST_DATA_TO_REMOVE[k]) {
+      k++;
+    } else if (bst_rank(bst, sorted[i]) != i - k
+        || bst_select(bst, i - k) != sorted[i]) {
+      num_bad_ranks++;
+    }
+  }
+  printf("\n== Checking ranks and selects after removal: %d wrong (expected 0)\n",
+    num_bad_ranks);
+
   /*
    * Test that all of the values we know should still be in the BST are indeed
    * there.
@@ -228,5 +264,43 @@ int main(int argc, char** argv) {
   free(sorted);
   bst_free(bst);
 
+  /*
+   * Insert sorted keys, which turn a plain BST into a list.  A balanced BST
+   * holding 2^10 - 1 sorted keys should be a perfect tree of height 9, and
+   * should stay balanced while every other key is removed.
+   */
+  if (balanced) {
+    printf("\n== Inserting 1023 sorted keys into a balanced BST...\n");
+    bst = bst_create_balanced();
+    for (int i = 0; i < 1023; i++) {
+      bst_insert(bst, i, (void*)&TEST_DATA[i % NUM_TEST_DATA]);
+    }
+    printf("  -- bst_height(): %d (expected 9)\n", bst_height(bst));
+
+    int missing = 0;
+    for (int i = 0; i < 1023; i += 2) {
+      bst_remove(bst, i);
+    }
+    for (int i = 0; i < 1023; i++) {
+      if ((bst_get(bst, i) != NULL) != (i % 2 == 1)) {
+        missing++;
+      }
+    }
+    printf("  -- wrong lookups after removing the even keys: %d (expected 0)\n",
+      missing);
+    printf("  -- bst_size(): %d (expected 511), bst_height(): %d (expected 8)\n",
+      bst_size(bst), bst_height(bst));
+
+    missing = 0;
+    for (int i = 0; i < 511; i++) {
+      if (bst_select(bst, i) != 2 * i + 1 || bst_rank(bst, 2 * i + 1) != i) {
+        missing++;
+      }
+    }
+    printf("  -- wrong ranks or selects of the odd keys: %d (expected 0)\n",
+      missing);
+    bst_free(bst);
+  }
+
   return 0;
 }
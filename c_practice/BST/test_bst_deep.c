@@ -0,0 +1,127 @@
+/*
+ * This file contains executable code for testing the BST functions on
+ * degenerate trees, plain BSTs built from sorted keys so that every node has
+ * at most one child.  Every test runs on a thread with a 64 KB stack, far
+ * less than an operation that recursed once per level would need on trees
+ * this deep.
+ *
+ * Every insert walks the whole chain, so building a chain takes quadratic
+ * time, which is what keeps DEPTH from being larger.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "bst.h"
+
+#define DEPTH 20000
+#define THREAD_STACK (64 * 1024)
+
+int keys[DEPTH + 1];
+
+/*
+ * Builds a plain BST holding keys 0 through DEPTH - 1, inserted in
+ * ascending or in descending order, so every node is the right or the left
+ * child of the one inserted before it.  Every node's value points at its key.
+ */
+struct bst* deep_bst(int ascending) {
+  struct bst* bst = bst_create();
+  for (int i = 0; i < DEPTH; i++) {
+    int key = ascending ? i : DEPTH - 1 - i;
+    bst_insert(bst, key, &keys[key]);
+  }
+  return bst;
+}
+
+void check_tree(const char* name, int ascending) {
+  struct bst* bst = deep_bst(ascending);
+  int deepest = ascending ? DEPTH - 1 : 0;
+  int root = ascending ? 0 : DEPTH - 1;
+
+  printf("\n== %s chain of %d nodes\n", name, DEPTH);
+  printf("  - size (expected %d): %d\n", DEPTH, bst_size(bst));
+  printf("  - height (expected %d): %d\n", DEPTH - 1, bst_height(bst));
+  printf("  - get deepest key (expected %d): %d\n", deepest,
+    *(int*)bst_get(bst, deepest));
+  printf("  - range sum of 1..1000 (expected 500500): %lld\n",
+    bst_range_sum(bst, 1, 1000));
+  printf("  - range sum of all keys (expected %lld): %lld\n",
+    (long long)DEPTH * (DEPTH - 1) / 2, bst_range_sum(bst, 0, DEPTH));
+  printf("  - rank and select of the middle key (expected %d %d): %d %d\n",
+    DEPTH / 2, DEPTH / 2, bst_rank(bst, DEPTH / 2), bst_select(bst, DEPTH / 2));
+
+  /*
+   * Check that the iterator returns every key in order.
+   */
+  struct bst_iterator* iter = bst_iterator_create(bst);
+  int visited = 0, in_order = 1;
+  while (bst_iterator_has_next(iter)) {
+    void* value;
+    int key = bst_iterator_next(iter, &value);
+    in_order = in_order && key == visited && value == &keys[key];
+    visited++;
+  }
+  bst_iterator_free(iter);
+  printf("  - iterator visits all keys in order (expected %d 1): %d %d\n",
+    DEPTH, visited, in_order);
+
+  /*
+   * Hang one more node below the deepest one, then take it away again along
+   * with the root, and put the new node back in the freed space.
+   */
+  int extra = ascending ? DEPTH : -1;
+  bst_insert(bst, extra, &keys[DEPTH]);
+  printf("  - height after insert below the deepest node (expected %d): %d\n",
+    DEPTH, bst_height(bst));
+  bst_remove(bst, extra);
+  bst_remove(bst, root);
+  printf("  - size after removing the new node and the root (expected %d): %d\n",
+    DEPTH - 1, bst_size(bst));
+  printf("  - get removed root (expected 1): %d\n", bst_get(bst, root) == NULL);
+  bst_insert(bst, extra, &keys[DEPTH]);
+  printf("  - size and height after inserting it again (expected %d %d): %d %d\n",
+    DEPTH, DEPTH - 1, bst_size(bst), bst_height(bst));
+
+  bst_free(bst);
+}
+
+/*
+ * Equal keys are placed to the right, so a chain of zero keys is a valid BST
+ * whose only root-to-leaf path sums to 0.
+ */
+void check_path_sum() {
+  struct bst* bst = bst_create();
+  for (int i = 0; i < DEPTH; i++) {
+    bst_insert(bst, 0, &keys[0]);
+  }
+  printf("\n== Chain of %d zero keys\n", DEPTH);
+  printf("  - path sum 0 (expected 1): %d\n", bst_path_sum(bst, 0));
+  printf("  - path sum 1 (expected 0): %d\n", bst_path_sum(bst, 1));
+  bst_free(bst);
+}
+
+void* run_tests(void* arg) {
+  check_tree("Ascending", 1);
+  check_tree("Descending", 0);
+  check_path_sum();
+  return NULL;
+}
+
+int main(int argc, char** argv) {
+  for (int i = 0; i <= DEPTH; i++) {
+    keys[i] = i;
+  }
+
+  pthread_attr_t attr;
+  pthread_t thread;
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, THREAD_STACK);
+  if (pthread_create(&thread, &attr, run_tests, NULL)) {
+    fprintf(stderr, "could not start test thread\n");
+    return 1;
+  }
+  pthread_join(thread, NULL);
+  pthread_attr_destroy(&attr);
+  return 0;
+}
@@ -0,0 +1,269 @@
+/*
+ * This file contains a hash aggregation operator.  Rows are folded into one
+ * value per group key with ht_upsert(), which probes the table once per row.
+ * The groups are split over several partition tables by the high bits of
+ * the key's hash code.  A batch of rows is first sorted by partition and then
+ * applied one partition at a time, so while a partition is updated only its
+ * own table has to be in the cache, even when all groups together are far
+ * larger than the cache.  See the documentation below for more information
+ * on the individual functions in this implementation.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <stdint.h>
+#include <assert.h>
+
+#include "hashers.h"
+#include "agg.h"
+
+/*
+ * This structure represents the whole aggregation.  Group keys are sent to
+ * partition `hash >> shift`.  `keys`, `args` and `codes` are scratch arrays
+ * of `room` rows that a batch is sorted into by partition, `row_codes` and
+ * `row_parts` keep the hash code and the partition of every row of a batch
+ * so `convert` runs once per row, and `counts` holds one counter per
+ * partition plus one for the sort.
+ */
+struct agg {
+    struct ht** parts;
+    int num_parts;
+    int shift;
+    unsigned int seed;
+    int (*convert)(void*);
+    void* (*init)(void* key, void* arg);
+    void* (*update)(void* value, void* arg);
+    void** keys;
+    void** args;
+    int* codes;
+    int* row_codes;
+    int* row_parts;
+    int room;
+    int* counts;
+};
+
+/*
+ * Auxilliary function that returns the partition of a group key whose hash
+ * code is `code`.  The partition tables hash keys with their own seeds, so
+ * the bits picked here say nothing about where a key lands inside its
+ * partition.
+ */
+static int _agg_partition_of(struct agg* a, int code) {
+    if (a->shift == 32) {
+        return 0;
+    }
+    return (int)(hash_mix32((unsigned int)code ^ a->seed) >> a->shift);
+}
+
+/*
+ * This function allocates and initializes a new, empty aggregation and
+ * returns a pointer to it.
+ *
+ * Params:
+ *   type - the storage engine of the partition tables.  May not be
+ *     HT_MAPPED.
+ *   partitions - the number of partitions, rounded up to a power of two.
+ *     Choose it so one partition's share of the groups fits in the cache.
+ *   convert - converts a group key to its hash code.
+ *   init - returns the first aggregate of a group, given its key and the
+ *     row's argument.
+ *   update - returns the new aggregate of a group, given its current
+ *     aggregate and the row's argument.
+ */
+struct agg* agg_create(enum ht_type type, int partitions, int (*convert)(void*),
+        void* (*init)(void* key, void* arg), void* (*update)(void* value, void* arg)) {
+    assert(type != HT_MAPPED && partitions > 0 && convert && init && update);
+    struct agg* a = malloc(sizeof(struct agg));
+    assert(a);
+
+    a->num_parts = 1;
+    a->shift = 32;
+    while (a->num_parts < partitions) {
+        a->num_parts *= 2;
+        a->shift--;
+    }
+    a->parts = malloc(a->num_parts * sizeof(struct ht*));
+    assert(a->parts);
+    for (int p = 0; p < a->num_parts; p++) {
+        a->parts[p] = ht_create_type(type);
+    }
+    a->seed = (unsigned int)hash_mix64((unsigned long long)time(NULL)
+        ^ (unsigned long long)(uintptr_t)a);
+    a->convert = convert;
+    a->init = init;
+    a->update = update;
+    a->keys = NULL;
+    a->args = NULL;
+    a->codes = NULL;
+    a->row_codes = NULL;
+    a->row_parts = NULL;
+    a->room = 0;
+    a->counts = malloc((a->num_parts + 1) * sizeof(int));
+    assert(a->counts);
+    return a;
+}
+
+/*
+ * This function frees the memory associated with an aggregation.  Group keys
+ * and aggregates are owned by the caller and are not freed.
+ *
+ * Params:
+ *   a - the aggregation to be destroyed.  May not be NULL.
+ */
+void agg_free(struct agg* a) {
+    assert(a);
+    for (int p = 0; p < a->num_parts; p++) {
+        ht_free(a->parts[p]);
+    }
+    free(a->parts);
+    free(a->keys);
+    free(a->args);
+    free(a->codes);
+    free(a->row_codes);
+    free(a->row_parts);
+    free(a->counts);
+    free(a);
+}
+
+/*
+ * This function sets the function used to compare group keys whose hash
+ * codes are equal.  See ht_set_key_cmp() in hash_table.c.  Must be called
+ * before any row is added.
+ *
+ * Params:
+ *   a - the aggregation to configure.  May not be NULL.
+ *   cmp - returns 0 when two keys are equal.
+ */
+void agg_set_key_cmp(struct agg* a, int (*cmp)(void* a, void* b)) {
+    assert(a);
+    for (int p = 0; p < a->num_parts; p++) {
+        ht_set_key_cmp(a->parts[p], cmp);
+    }
+}
+
+/*
+ * This function adds one row to an aggregation.  For many rows prefer
+ * agg_add_batch(), which touches one partition at a time.  The key of the
+ * first row of a group is the one stored, so it must stay valid as long as
+ * the aggregation.
+ *
+ * Params:
+ *   a - the aggregation to add to.  May not be NULL.
+ *   key - the group key of the row.
+ *   arg - passed to `init` or `update`, e.g. the value being aggregated.
+ */
+void agg_add(struct agg* a, void* key, void* arg) {
+    assert(a);
+    int code = a->convert(key);
+    ht_upsert_batch_codes(a->parts[_agg_partition_of(a, code)], &key, &code, &arg, 1,
+        a->init, a->update);
+}
+
+/*
+ * Auxilliary function that makes sure the scratch arrays hold `n` rows.
+ */
+static void _agg_reserve(struct agg* a, int n) {
+    if (n <= a->room) {
+        return;
+    }
+    free(a->keys);
+    free(a->args);
+    free(a->codes);
+    free(a->row_codes);
+    free(a->row_parts);
+    a->keys = malloc(n * sizeof(void*));
+    a->args = malloc(n * sizeof(void*));
+    a->codes = malloc(n * sizeof(int));
+    a->row_codes = malloc(n * sizeof(int));
+    a->row_parts = malloc(n * sizeof(int));
+    assert(a->keys && a->args && a->codes && a->row_codes && a->row_parts);
+    a->room = n;
+}
+
+/*
+ * This function adds a batch of rows to an aggregation.  The rows are sorted
+ * by partition with a counting sort, which keeps their order within every
+ * partition, and each partition is then updated with one
+ * ht_upsert_batch_codes() call.  `convert` is called once per row.  The rows
+ * of one group are still folded in the order they were passed.
+ *
+ * Params:
+ *   a - the aggregation to add to.  May not be NULL.
+ *   keys - array of `n` group keys.
+ *   args - array of `n` arguments, args[i] is passed to `init` or `update`
+ *     for keys[i].  May be NULL, then they receive NULL.
+ *   n - the number of rows.
+ */
+void agg_add_batch(struct agg* a, void** keys, void** args, int n) {
+    assert(a);
+    if (a->num_parts == 1) {
+        ht_upsert_batch(a->parts[0], keys, args, n, a->convert, a->init, a->update);
+        return;
+    }
+    _agg_reserve(a, n);
+
+    // count the rows of every partition, then turn the counts into the
+    // offset of every partition's first row in the scratch arrays
+    int* counts = a->counts;
+    memset(counts, 0, (a->num_parts + 1) * sizeof(int));
+    for (int i = 0; i < n; i++) {
+        a->row_codes[i] = a->convert(keys[i]);
+        a->row_parts[i] = _agg_partition_of(a, a->row_codes[i]);
+        counts[a->row_parts[i] + 1]++;
+    }
+    for (int p = 0; p < a->num_parts; p++) {
+        counts[p + 1] += counts[p];
+    }
+    for (int i = 0; i < n; i++) {
+        int pos = counts[a->row_parts[i]]++;
+        a->keys[pos] = keys[i];
+        a->codes[pos] = a->row_codes[i];
+        a->args[pos] = args ? args[i] : NULL;
+    }
+
+    // counts[p] now points at the end of partition p
+    int start = 0;
+    for (int p = 0; p < a->num_parts; p++) {
+        int end = counts[p];
+        if (end > start) {
+            ht_upsert_batch_codes(a->parts[p], a->keys + start, a->codes + start,
+                a->args + start, end - start, a->init, a->update);
+        }
+        start = end;
+    }
+}
+
+/*
+ * This function returns the number of groups of an aggregation.
+ */
+int agg_size(struct agg* a) {
+    assert(a);
+    int size = 0;
+    for (int p = 0; p < a->num_parts; p++) {
+        size += ht_size(a->parts[p]);
+    }
+    return size;
+}
+
+/*
+ * This function returns the number of partitions of an aggregation.
+ */
+int agg_partitions(struct agg* a) {
+    assert(a);
+    return a->num_parts;
+}
+
+/*
+ * This function returns the table of one partition, so the groups can be
+ * read back with ht_scan() or ht_lookup().  Every group is in exactly one
+ * partition.  The table belongs to the aggregation and may not be freed.
+ *
+ * Params:
+ *   a - the aggregation to read.  May not be NULL.
+ *   p - the partition, between 0 and agg_partitions() - 1.
+ */
+struct ht* agg_partition(struct agg* a, int p) {
+    assert(a && p >= 0 && p < a->num_parts);
+    return a->parts[p];
+}
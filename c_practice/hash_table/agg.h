@@ -0,0 +1,32 @@
+/*
+ * This file contains the definition of the interface for a hash aggregation
+ * operator, the table behind a group-by.  You can find descriptions of the
+ * operator functions, including their parameters and their return values,
+ * in agg.c.
+ */
+
+#ifndef __AGG_H
+#define __AGG_H
+
+#include "hash_table.h"
+
+/*
+ * Structure used to represent an aggregation.
+ */
+struct agg;
+
+/*
+ * Aggregation interface function prototypes.  Refer to agg.c for
+ * documentation about each of these functions.
+ */
+struct agg* agg_create(enum ht_type type, int partitions, int (*convert)(void*),
+        void* (*init)(void* key, void* arg), void* (*update)(void* value, void* arg));
+void agg_free(struct agg* a);
+void agg_set_key_cmp(struct agg* a, int (*cmp)(void* a, void* b));
+void agg_add(struct agg* a, void* key, void* arg);
+void agg_add_batch(struct agg* a, void** keys, void** args, int n);
+int agg_size(struct agg* a);
+int agg_partitions(struct agg* a);
+struct ht* agg_partition(struct agg* a, int p);
+
+#endif
@@ -0,0 +1,191 @@
+/*
+ * This is a small program that measures group-by throughput: it sums a
+ * synthetic stream of (group, value) rows into one total per group, first
+ * with a lookup followed by an insert per row, then with upserts, batched
+ * upserts and partitioned aggregation.  Run it as
+ * `./bench_agg [num_rows] [num_groups] [robin_hood|swiss]`.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "hash_table.h"
+#include "agg.h"
+
+/*
+ * Number of rows generated and added at a time.  The whole stream is never
+ * held in memory.
+ */
+#define CHUNK_ROWS (1 << 20)
+
+/*
+ * This is a convert function to be used to convert the integer key
+ */
+int convert_int(void* key){
+    int *k = key;
+    return *k;
+}
+
+/*
+ * These functions sum the values of a group.  Rows pass their value as the
+ * argument and the sum is stored in the value pointer itself.
+ */
+void* sum_init(void* key, void* arg){
+    return arg;
+}
+
+void* sum_update(void* value, void* arg){
+    return (void*)((intptr_t)value + (intptr_t)arg);
+}
+
+/*
+ * This function returns the current time in seconds from a monotonic clock.
+ */
+double now(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * This structure holds one chunk of the row stream and the state of the
+ * generator, so every method sees exactly the same rows, and room to scan
+ * the groups back.
+ */
+struct stream {
+    unsigned long long state;
+    int* keys;
+    int num_groups;
+    void* row_keys[CHUNK_ROWS];
+    void* row_vals[CHUNK_ROWS];
+    struct ht_entry entries[1024];
+};
+
+/*
+ * This function fills the next `n` rows of a stream from a xorshift
+ * generator.  Groups are uniform and values are between 1 and 100, so no
+ * sum is ever 0 and looks like a missing group.
+ */
+void next_chunk(struct stream* s, int n){
+    unsigned long long x = s->state;
+    for (int i = 0; i < n; i++){
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        s->row_keys[i] = &s->keys[(x >> 20) % s->num_groups];
+        s->row_vals[i] = (void*)(intptr_t)(x % 100 + 1);
+    }
+    s->state = x;
+}
+
+/*
+ * This function adds the rows of a chunk to a table with ht_lookup() and
+ * ht_insert(), which probes the table twice per row.
+ */
+void add_naive(struct ht* ht, struct stream* s, int n){
+    for (int i = 0; i < n; i++){
+        void* sum = ht_lookup(ht, s->row_keys[i], convert_int);
+        ht_insert(ht, s->row_keys[i], (void*)((intptr_t)sum + (intptr_t)s->row_vals[i]), convert_int);
+    }
+}
+
+/*
+ * This function adds the rows of a chunk with one ht_upsert() per row.
+ */
+void add_upsert(struct ht* ht, struct stream* s, int n){
+    for (int i = 0; i < n; i++)
+        ht_upsert(ht, s->row_keys[i], convert_int, sum_init, sum_update, s->row_vals[i]);
+}
+
+/*
+ * This function adds the rows of a chunk with ht_upsert_batch().
+ */
+void add_batch(struct ht* ht, struct stream* s, int n){
+    ht_upsert_batch(ht, s->row_keys, s->row_vals, n, convert_int, sum_init, sum_update);
+}
+
+/*
+ * This function runs one method over the whole stream and prints its
+ * throughput, the number of groups and the sum over all groups.  Exactly one
+ * of `add` and `partitions` is used: with `partitions` > 0 the rows go to an
+ * aggregation with that many partitions.
+ */
+void run(const char* name, enum ht_type type, void (*add)(struct ht*, struct stream*, int),
+        int partitions, struct stream* s, long long rows){
+    struct ht* ht = NULL;
+    struct agg* a = NULL;
+    double gen = 0, start, t;
+    long long total = 0;
+    int groups = 0;
+
+    if (partitions > 0)
+        a = agg_create(type, partitions, convert_int, sum_init, sum_update);
+    else
+        ht = ht_create_type(type);
+    s->state = 88172645463325252ULL;
+
+    start = now();
+    for (long long done = 0; done < rows; done += CHUNK_ROWS){
+        int n = rows - done < CHUNK_ROWS ? (int)(rows - done) : CHUNK_ROWS;
+        t = now();
+        next_chunk(s, n);
+        gen += now() - t;
+        if (a)
+            agg_add_batch(a, s->row_keys, s->row_vals, n);
+        else
+            add(ht, s, n);
+    }
+    t = now() - start - gen;
+
+    int num_tables = a ? agg_partitions(a) : 1;
+    for (int p = 0; p < num_tables; p++){
+        struct ht* table = a ? agg_partition(a, p) : ht;
+        unsigned int cursor = 0;
+        do {
+            int got = ht_scan(table, &cursor, 1024, s->entries);
+            for (int i = 0; i < got; i++)
+                total += (intptr_t)s->entries[i].value;
+            groups += got > 0 ? got : 0;
+        } while (cursor != 0);
+    }
+    printf("%-22s %8.3f s %8.1f Mrows/s   groups %d   sum %lld\n",
+        name, t, rows / t / 1e6, groups, total);
+
+    if (a)
+        agg_free(a);
+    else
+        ht_free(ht);
+}
+
+int main(int argc, char** argv){
+    long long rows = argc > 1 ? atoll(argv[1]) : 100000000LL;
+    int num_groups = argc > 2 ? atoi(argv[2]) : 1 << 20;
+    enum ht_type type = HT_ROBIN_HOOD;
+    struct stream* s = malloc(sizeof(struct stream));
+
+    if (argc > 3 && strcmp(argv[3], "swiss") == 0)
+        type = HT_SWISS;
+    else if (argc > 3 && strcmp(argv[3], "chaining") == 0)
+        type = HT_CHAINING;
+    s->num_groups = num_groups;
+    s->keys = malloc(num_groups * sizeof(int));
+    for (int g = 0; g < num_groups; g++)
+        s->keys[g] = g;
+
+    printf("Summing %lld rows into %d groups (%s)...\n", rows, num_groups,
+        type == HT_SWISS ? "swiss" : type == HT_CHAINING ? "chaining" : "robin_hood");
+    run("lookup + insert", type, add_naive, 0, s, rows);
+    run("ht_upsert", type, add_upsert, 0, s, rows);
+    run("ht_upsert_batch", type, add_batch, 0, s, rows);
+    run("agg, 16 partitions", type, NULL, 16, s, rows);
+    run("agg, 256 partitions", type, NULL, 256, s, rows);
+
+    free(s->keys);
+    free(s);
+    return 0;
+}
@@ -0,0 +1,124 @@
+/*
+ * This is a small program that measures how the concurrent hash table scales
+ * with the number of threads on a 90% lookup / 10% write workload.  It
+ * compares against a plain struct ht behind one global mutex, which is how
+ * tables used to be shared.  Run it as `./bench_cht [max_threads] [ops]`.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "hash_table.h"
+#include "concurrent_ht.h"
+
+#define NUM_KEYS (1 << 20)
+
+int keys[2 * NUM_KEYS];
+int ops_per_thread;
+
+struct cht* cht;
+struct ht* ht;
+pthread_mutex_t ht_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * This is a convert function to be used to convert the integer key
+ */
+int convert_int(void* key){
+    int *k = key;
+    return *k;
+}
+
+/*
+ * This function returns the current time in seconds from a monotonic clock.
+ */
+double now(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Each worker runs `ops_per_thread` operations on random keys: 90% lookups,
+ * 5% inserts and 5% removes.  Half of the key space is in the table at the
+ * start, so about half of the lookups hit.
+ */
+void* cht_worker(void* arg){
+    unsigned int seed = (unsigned int)(long)arg;
+    for (int i = 0; i < ops_per_thread; i++){
+        seed = seed * 1103515245u + 12345u;
+        int* key = &keys[(seed >> 4) % (2 * NUM_KEYS)];
+        int op = (seed >> 24) % 20;
+        if (op == 0)
+            cht_insert(cht, key, key, convert_int);
+        else if (op == 1)
+            cht_remove(cht, key, convert_int);
+        else
+            cht_lookup(cht, key, convert_int);
+    }
+    return NULL;
+}
+
+void* ht_worker(void* arg){
+    unsigned int seed = (unsigned int)(long)arg;
+    for (int i = 0; i < ops_per_thread; i++){
+        seed = seed * 1103515245u + 12345u;
+        int* key = &keys[(seed >> 4) % (2 * NUM_KEYS)];
+        int op = (seed >> 24) % 20;
+        pthread_mutex_lock(&ht_lock);
+        if (op == 0)
+            ht_insert(ht, key, key, convert_int);
+        else if (op == 1)
+            ht_remove(ht, key, convert_int);
+        else
+            ht_lookup(ht, key, convert_int);
+        pthread_mutex_unlock(&ht_lock);
+    }
+    return NULL;
+}
+
+/*
+ * This function runs `nthreads` copies of `worker` and returns the total
+ * throughput in operations per second.
+ */
+double run(void* (*worker)(void*), int nthreads){
+    pthread_t* threads = malloc(nthreads * sizeof(pthread_t));
+    double start = now();
+    for (int i = 0; i < nthreads; i++)
+        pthread_create(&threads[i], NULL, worker, (void*)(long)(i + 1));
+    for (int i = 0; i < nthreads; i++)
+        pthread_join(threads[i], NULL);
+    double secs = now() - start;
+    free(threads);
+    return (double)nthreads * ops_per_thread / secs;
+}
+
+int main(int argc, char** argv){
+    int max_threads = argc > 1 ? atoi(argv[1]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    ops_per_thread = argc > 2 ? atoi(argv[2]) : 2000000;
+
+    for (int i = 0; i < 2 * NUM_KEYS; i++)
+        keys[i] = i;
+
+    printf("90/10 read/write, %d ops per thread, %d keys preloaded\n",
+        ops_per_thread, NUM_KEYS);
+    printf("%8s %18s %18s\n", "threads", "cht ops/s", "ht+mutex ops/s");
+    for (int n = 1; n <= max_threads; n++){
+        cht = cht_create();
+        ht = ht_create();
+        for (int i = 0; i < 2 * NUM_KEYS; i += 2){
+            cht_insert(cht, &keys[i], &keys[i], convert_int);
+            ht_insert(ht, &keys[i], &keys[i], convert_int);
+        }
+        double c = run(cht_worker, n);
+        double h = run(ht_worker, n);
+        printf("%8d %18.0f %18.0f\n", n, c, h);
+        cht_free(cht);
+        ht_free(ht);
+    }
+    return 0;
+}
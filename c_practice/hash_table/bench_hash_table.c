@@ -0,0 +1,570 @@
+/*
+ * This is a small program that compares the throughput of the hash table
+ * storage engines side by side.  Run it as `./bench_ht [num_keys]`.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#include "hash_table.h"
+#include "list.h"
+#include "node_pool.h"
+
+/*
+ * This is a convert function to be used to convert the integer key
+ */
+int convert_int(void* key){
+    int *k = key;
+    return *k;
+}
+
+/*
+ * This function returns the current time in seconds from a monotonic clock.
+ */
+double now(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * This function prints the throughput of one timed phase in millions of
+ * operations per second.
+ */
+void report(const char* phase, int n, double secs){
+    printf("  %-14s %10.2f Mops/s  (%.3f s)\n", phase, n / secs / 1e6, secs);
+}
+
+/*
+ * Number of keys handed to ht_lookup_batch at once.
+ */
+#define BATCH 256
+
+/*
+ * This function runs the insert / hit / miss / batch hit / remove phases against one
+ * storage engine.  `hits` holds the keys that get inserted and `misses` holds
+ * keys that are known not to be in the table.
+ */
+void bench_engine(const char* name, enum ht_type type, int* hits, int* misses, int n){
+    struct ht* ht = ht_create_type(type);
+    void** keys = malloc(n * sizeof(void*));
+    void* out[BATCH];
+    long found = 0;
+    double start;
+
+    printf("\n== %s\n", name);
+
+    start = now();
+    for (int i = 0; i < n; i++)
+        ht_insert(ht, &hits[i], &hits[i], convert_int);
+    report("insert", n, now() - start);
+
+    for (int i = 0; i < n; i++)
+        keys[i] = &hits[i];
+
+    start = now();
+    for (int i = 0; i < n; i++)
+        found += ht_lookup(ht, &hits[i], convert_int) != NULL;
+    report("lookup hit", n, now() - start);
+
+    start = now();
+    for (int i = 0; i < n; i++)
+        found += ht_lookup(ht, &misses[i], convert_int) != NULL;
+    report("lookup miss", n, now() - start);
+
+    start = now();
+    for (int i = 0; i < n; i += BATCH){
+        int len = n - i < BATCH ? n - i : BATCH;
+        ht_lookup_batch(ht, keys + i, len, convert_int, out);
+        for (int j = 0; j < len; j++)
+            found += out[j] != NULL;
+    }
+    report("batch hit", n, now() - start);
+
+    start = now();
+    for (int i = 0; i < n; i++)
+        ht_remove(ht, &hits[i], convert_int);
+    report("remove", n, now() - start);
+
+    printf("  found %ld of %d, size after removal %d\n", found, 2 * n, ht_size(ht));
+    free(keys);
+    ht_free(ht);
+}
+
+/*
+ * This function times every single insert into a fresh table and reports the
+ * slowest one.  Tables that resize all at once show it as one long stall.
+ */
+void bench_latency(const char* name, enum ht_type type, int* hits, int n){
+    struct ht* ht = ht_create_type(type);
+    double worst = 0, start, t;
+
+    for (int i = 0; i < n; i++){
+        start = now();
+        ht_insert(ht, &hits[i], &hits[i], convert_int);
+        t = now() - start;
+        if (t > worst)
+            worst = t;
+    }
+    printf("  %-14s worst insert %8.3f ms\n", name, worst * 1e3);
+    ht_free(ht);
+}
+
+/*
+ * This function fills a table with `n` keys and times hit and miss lookups.
+ * For open-addressed engines `n` is picked so the table ends up at a given
+ * load factor.
+ */
+void bench_lookups(const char* name, enum ht_type type, int* hits, int* misses, int n){
+    struct ht* ht = ht_create_type(type);
+    long found = 0;
+    double hit, miss, start;
+
+    for (int i = 0; i < n; i++)
+        ht_insert(ht, &hits[i], &hits[i], convert_int);
+
+    start = now();
+    for (int i = 0; i < n; i++)
+        found += ht_lookup(ht, &hits[i], convert_int) != NULL;
+    hit = now() - start;
+
+    start = now();
+    for (int i = 0; i < n; i++)
+        found += ht_lookup(ht, &misses[i], convert_int) != NULL;
+    miss = now() - start;
+
+    printf("    %-12s hit %8.2f Mops/s   miss %8.2f Mops/s\n", name,
+        n / hit / 1e6, n / miss / 1e6);
+    if (found != n)
+        printf("    %-12s found %ld of %d keys!\n", name, found, n);
+    ht_free(ht);
+}
+
+/*
+ * This function fills a table with `n` keys and times a stream of `n`
+ * lookups of which four in five miss, first without and then with the
+ * table's Bloom filter.
+ */
+void bench_bloom(const char* name, enum ht_type type, int* hits, int* misses, int n){
+    struct ht* ht = ht_create_type(type);
+    int** keys = malloc(n * sizeof(int*));
+    long found[2] = { 0, 0 };
+    double secs[2], start;
+
+    for (int i = 0; i < n; i++)
+        ht_insert(ht, &hits[i], &hits[i], convert_int);
+    for (int i = 0; i < n; i++)
+        keys[i] = i % 5 == 0 ? &hits[i] : &misses[i];
+
+    for (int f = 0; f < 2; f++){
+        ht_enable_bloom(ht, f);
+        start = now();
+        for (int i = 0; i < n; i++)
+            found[f] += ht_lookup(ht, keys[i], convert_int) != NULL;
+        secs[f] = now() - start;
+    }
+    printf("  %-14s no filter %8.2f Mops/s   filter %8.2f Mops/s   (%.2fx)\n", name,
+        n / secs[0] / 1e6, n / secs[1] / 1e6, secs[0] / secs[1]);
+    if (found[0] != found[1] || found[0] != (n + 4) / 5)
+        printf("  %-14s found %ld and %ld of %d keys!\n", name, found[0], found[1], (n + 4) / 5);
+    free(keys);
+    ht_free(ht);
+}
+
+/*
+ * This function returns the number of bytes currently allocated by malloc,
+ * or 0 where the C library cannot tell.
+ */
+size_t heap_in_use(){
+#ifdef __GLIBC__
+    return mallinfo2().uordblks;
+#else
+    return 0;
+#endif
+}
+
+/*
+ * This function builds `n` chain nodes spread over 1024 lists, once with one
+ * malloc per node and once from a node pool, and reports the heap bytes each
+ * node costs and how long tearing the lists down takes.
+ */
+void bench_nodes(int* hits, int n){
+    struct list* lists[1024];
+    struct node_pool* pool;
+    size_t base;
+    double start, per_malloc, per_pool;
+
+    base = heap_in_use();
+    for (int i = 0; i < 1024; i++)
+        lists[i] = list_create();
+    for (int i = 0; i < n; i++)
+        list_insert_entry(lists[i % 1024], &hits[i], &hits[i], hits[i], NULL);
+    per_malloc = (double)(heap_in_use() - base) / n;
+    start = now();
+    for (int i = 0; i < 1024; i++)
+        list_free(lists[i]);
+    printf("  %-14s %6.1f bytes/entry   teardown %8.3f ms\n", "malloc",
+        per_malloc, (now() - start) * 1e3);
+
+    base = heap_in_use();
+    pool = pool_create(list_node_size());
+    for (int i = 0; i < 1024; i++)
+        lists[i] = list_create();
+    for (int i = 0; i < n; i++)
+        list_insert_entry(lists[i % 1024], &hits[i], &hits[i], hits[i], pool);
+    per_pool = (double)(heap_in_use() - base) / n;
+    start = now();
+    for (int i = 0; i < 1024; i++)
+        list_release(lists[i], pool);
+    pool_free(pool);
+    printf("  %-14s %6.1f bytes/entry   teardown %8.3f ms\n", "node pool",
+        per_pool, (now() - start) * 1e3);
+
+    printf("  node size %d bytes, pool saves %.1f bytes/entry\n",
+        (int)list_node_size(), per_malloc - per_pool);
+}
+
+/*
+ * This function creates many tables of one engine, first empty and then
+ * holding `entries` keys each, and reports the heap bytes a table costs and
+ * how fast its keys are looked up.
+ */
+void bench_small(const char* name, enum ht_type type, int* hits, int entries){
+    const int tables = 10000;
+    struct ht** hts = malloc(tables * sizeof(struct ht*));
+    size_t base = heap_in_use();
+    double empty, full, start;
+
+    for (int t = 0; t < tables; t++)
+        hts[t] = ht_create_type(type);
+    empty = (double)(heap_in_use() - base) / tables;
+    for (int t = 0; t < tables; t++)
+        for (int i = 0; i < entries; i++)
+            ht_insert(hts[t], &hits[t * entries + i], &hits[t * entries + i], convert_int);
+    full = (double)(heap_in_use() - base) / tables;
+
+    start = now();
+    for (int round = 0; round < 10; round++)
+        for (int t = 0; t < tables; t++)
+            for (int i = 0; i < entries; i++)
+                if (ht_lookup(hts[t], &hits[t * entries + i], convert_int) == NULL)
+                    printf("missing key\n");
+    printf("  %-12s %2d keys   empty %6.0f bytes   full %6.0f bytes   lookups %7.2f Mops/s\n",
+        name, entries, empty, full, 10.0 * tables * entries / (now() - start) / 1e6);
+
+    for (int t = 0; t < tables; t++)
+        ht_free(hts[t]);
+    free(hts);
+}
+
+/*
+ * This function fills a chained table with `n` keys and times one resize
+ * that moves all of them at once, on 1 up to `max_threads` threads.
+ */
+void bench_parallel_resize(int* hits, int n, int max_threads){
+    double base = 0;
+
+    for (int threads = 1; threads <= max_threads; threads *= 2){
+        struct ht* ht = ht_create_type(HT_CHAINING);
+        double start, secs;
+
+        ht_set_resize_threads(ht, threads);
+        for (int i = 0; i < n; i++)
+            ht_insert(ht, &hits[i], &hits[i], convert_int);
+        start = now();
+        resize(ht, convert_int);
+        secs = now() - start;
+        if (threads == 1)
+            base = secs;
+        printf("  %2d threads   %8d -> %8d buckets %8.3f ms   speedup %.2fx\n", threads,
+            ht_capacity(ht) / 2, ht_capacity(ht), secs * 1e3, base / secs);
+        ht_free(ht);
+    }
+}
+
+/*
+ * This function compares what it takes to set up `n` empty chaining buckets
+ * with one malloc per bucket against a table that reserved room for `n`
+ * keys, whose buckets are inline heads that start out NULL.
+ */
+void bench_empty(int n){
+    struct list** lists = malloc(n * sizeof(struct list*));
+    struct ht* ht;
+    size_t base;
+    double start, setup, teardown;
+
+    base = heap_in_use();
+    start = now();
+    for (int i = 0; i < n; i++)
+        lists[i] = list_create();
+    setup = now() - start;
+    printf("  %-14s %8.1f KiB   setup %8.3f ms", "malloc each",
+        (heap_in_use() - base) / 1024.0, setup * 1e3);
+    start = now();
+    for (int i = 0; i < n; i++)
+        list_free(lists[i]);
+    printf("   teardown %8.3f ms\n", (now() - start) * 1e3);
+    free(lists);
+
+    base = heap_in_use();
+    start = now();
+    ht = ht_create_with_capacity(n);
+    setup = now() - start;
+    printf("  %-14s %8.1f KiB   setup %8.3f ms", "inline heads",
+        (heap_in_use() - base) / 1024.0, setup * 1e3);
+    start = now();
+    ht_free(ht);
+    teardown = now() - start;
+    printf("   teardown %8.3f ms\n", teardown * 1e3);
+}
+
+/*
+ * This function compares a cold start, which rebuilds a table from its keys,
+ * against a warm start from a snapshot of the same table.
+ */
+void bench_snapshot(int* hits, int n){
+    struct ht* ht = ht_create_type(HT_SWISS);
+    double start, build, save, open;
+    long found = 0;
+
+    start = now();
+    for (int i = 0; i < n; i++)
+        ht_insert(ht, &hits[i], &hits[i], convert_int);
+    build = now() - start;
+
+    start = now();
+    if (ht_save(ht, "bench_ht.snap", sizeof(int)) != 0){
+        printf("  could not write bench_ht.snap\n");
+        ht_free(ht);
+        return;
+    }
+    save = now() - start;
+    ht_free(ht);
+
+    start = now();
+    ht = ht_open_mapped("bench_ht.snap");
+    open = now() - start;
+    printf("  %-14s %8.3f ms\n", "rebuild", build * 1e3);
+    printf("  %-14s %8.3f ms\n", "save", save * 1e3);
+    printf("  %-14s %8.3f ms\n", "open mapped", open * 1e3);
+
+    start = now();
+    for (int i = 0; i < n; i++)
+        found += ht_lookup(ht, &hits[i], convert_int) != NULL;
+    report("mapped hit", n, now() - start);
+    printf("  found %ld of %d\n", found, n);
+    ht_free(ht);
+    remove("bench_ht.snap");
+}
+
+/*
+ * This function times loading `n` keys into a table that grows as it goes
+ * against one that reserved room for all of them up front.
+ */
+void bench_reserve(const char* name, enum ht_type type, int* hits, int n){
+    struct ht* grown = ht_create_type(type);
+    struct ht* reserved = ht_create_type(type);
+    double start, grow, res;
+
+    start = now();
+    for (int i = 0; i < n; i++)
+        ht_insert(grown, &hits[i], &hits[i], convert_int);
+    grow = now() - start;
+
+    start = now();
+    ht_reserve(reserved, n);
+    for (int i = 0; i < n; i++)
+        ht_insert(reserved, &hits[i], &hits[i], convert_int);
+    res = now() - start;
+
+    printf("  %-14s growing %8.3f ms   reserved %8.3f ms\n", name, grow * 1e3, res * 1e3);
+    ht_free(grown);
+    ht_free(reserved);
+}
+
+/*
+ * This function prints the chain length distribution of `n` bucket indices
+ * spread over `nb` buckets: the longest chain, the share of empty buckets
+ * and the average number of entries a hit has to walk past.
+ */
+void report_chains(const char* name, int* idx, int n, int nb){
+    int* len = calloc(nb, sizeof(int));
+    long probes = 0;
+    int longest = 0, empty = 0;
+
+    for (int i = 0; i < n; i++)
+        len[idx[i]]++;
+    for (int b = 0; b < nb; b++){
+        probes += (long)len[b] * (len[b] + 1) / 2;
+        if (len[b] > longest)
+            longest = len[b];
+        if (len[b] == 0)
+            empty++;
+    }
+    printf("    %-14s longest chain %6d   empty buckets %5.1f%%   probes/hit %7.2f\n",
+        name, longest, 100.0 * empty / nb, (double)probes / n);
+    free(len);
+}
+
+/*
+ * This function loads `n` keys that are multiples of `stride` into a
+ * chained table and compares its chain lengths against what the raw key
+ * masked by the bucket count, the old indexing, would have given.
+ */
+void bench_chains(int stride, int n){
+    int* keys = malloc(n * sizeof(int));
+    int* idx = malloc(n * sizeof(int));
+    struct ht* ht = ht_create_with_capacity(n);
+
+    for (int i = 0; i < n; i++){
+        keys[i] = (int)((unsigned int)i * (unsigned int)stride);
+        ht_insert(ht, &keys[i], &keys[i], convert_int);
+    }
+    int nb = ht_capacity(ht);
+    printf("  keys i * %d, %d buckets\n", stride, nb);
+
+    for (int i = 0; i < n; i++)
+        idx[i] = (unsigned int)keys[i] & (unsigned int)(nb - 1);
+    report_chains("raw key", idx, n, nb);
+    for (int i = 0; i < n; i++)
+        idx[i] = ht_hash_func(ht, &keys[i], convert_int);
+    report_chains("seeded mix", idx, n, nb);
+
+    ht_free(ht);
+    free(keys);
+    free(idx);
+}
+
+/*
+ * This function loads `n` keys into a table with statistics turned on, runs
+ * hit and miss lookups, and prints what ht_stats() reports.  It also times
+ * the same lookups with statistics off and on.
+ */
+void bench_stats(const char* name, enum ht_type type, int* hits, int* misses, int n){
+    struct ht* ht = ht_create_type(type);
+    struct ht_stats st;
+    double start, off, on;
+
+    ht_enable_stats(ht, 1);
+    for (int i = 0; i < n; i++)
+        ht_insert(ht, &hits[i], &hits[i], convert_int);
+    for (int i = 0; i < n; i++){
+        ht_lookup(ht, &hits[i], convert_int);
+        ht_lookup(ht, &misses[i], convert_int);
+    }
+    ht_stats(ht, &st);
+
+    printf("  %s\n    occupancy", name);
+    for (int i = 0; i < HT_STATS_BINS; i++)
+        printf(" %ld", st.occupancy[i]);
+    printf("\n    probes/hit avg %.2f max %d   probes/miss avg %.2f max %d\n",
+        st.avg_probes_hit, st.max_probes_hit, st.avg_probes_miss, st.max_probes_miss);
+    printf("    %ld resizes, %.3f ms resizing\n", st.resizes, st.resize_ns / 1e6);
+
+    start = now();
+    for (int i = 0; i < n; i++)
+        ht_lookup(ht, &hits[i], convert_int);
+    on = now() - start;
+    ht_enable_stats(ht, 0);
+    start = now();
+    for (int i = 0; i < n; i++)
+        ht_lookup(ht, &hits[i], convert_int);
+    off = now() - start;
+    printf("    lookup hit %.2f Mops/s with stats off, %.2f Mops/s with stats on\n",
+        n / off / 1e6, n / on / 1e6);
+    ht_free(ht);
+}
+
+int main(int argc, char** argv){
+    int n = argc > 1 ? atoi(argv[1]) : 1 << 20;
+    int* hits = malloc(n * sizeof(int));
+    int* misses = malloc(n * sizeof(int));
+
+    /*
+     * Scatter the keys with an odd multiplier modulo 2^30 so they are
+     * distinct, non-negative and not sequential.  Hits are even and misses
+     * are odd, so no miss key is ever in the table.
+     */
+    for (int i = 0; i < n; i++){
+        unsigned int k = ((unsigned int)i * 2654435761u) & 0x3fffffff;
+        hits[i] = (int)(k * 2);
+        misses[i] = (int)(k * 2 + 1);
+    }
+
+    printf("Benchmarking %d keys per engine...\n", n);
+    bench_engine("chaining", HT_CHAINING, hits, misses, n);
+    bench_engine("robin hood", HT_ROBIN_HOOD, hits, misses, n);
+    bench_engine("swiss", HT_SWISS, hits, misses, n);
+
+    printf("\n== Chain lengths\n");
+    bench_chains(1, n);
+    bench_chains(64, n);
+    bench_chains(4096, n);
+
+    printf("\n== Statistics\n");
+    bench_stats("chaining", HT_CHAINING, hits, misses, n);
+    bench_stats("robin hood", HT_ROBIN_HOOD, hits, misses, n);
+    bench_stats("swiss", HT_SWISS, hits, misses, n);
+
+    printf("\n== Bloom filter, 80%% misses\n");
+    bench_bloom("chaining", HT_CHAINING, hits, misses, n);
+    bench_bloom("robin hood", HT_ROBIN_HOOD, hits, misses, n);
+    bench_bloom("swiss", HT_SWISS, hits, misses, n);
+
+    printf("\n== Bulk load\n");
+    bench_reserve("chaining", HT_CHAINING, hits, n);
+    bench_reserve("robin hood", HT_ROBIN_HOOD, hits, n);
+    bench_reserve("swiss", HT_SWISS, hits, n);
+
+    printf("\n== Parallel resize\n");
+    bench_parallel_resize(hits, n, 8);
+
+    printf("\n== Empty buckets\n");
+    bench_empty(n);
+
+    printf("\n== Small tables\n");
+    for (int entries = 4; entries <= 8 && entries * 10000 <= n; entries *= 2){
+        bench_small("chaining", HT_CHAINING, hits, entries);
+        bench_small("robin hood", HT_ROBIN_HOOD, hits, entries);
+        bench_small("swiss", HT_SWISS, hits, entries);
+    }
+
+    printf("\n== Chain node memory\n");
+    bench_nodes(hits, n);
+
+    printf("\n== Snapshot\n");
+    bench_snapshot(hits, n);
+
+    printf("\n== Insert latency\n");
+    bench_latency("chaining", HT_CHAINING, hits, n);
+    bench_latency("robin hood", HT_ROBIN_HOOD, hits, n);
+    bench_latency("swiss", HT_SWISS, hits, n);
+
+    /*
+     * The Swiss table starts at 16 slots and doubles once 7/8 of them are
+     * used, so after inserting `lf * slots` keys (lf between 0.5 and 0.875)
+     * it holds exactly `slots` slots.  Pick the largest slot count the key
+     * arrays can fill.
+     */
+    int slots = 16;
+    while (slots * 2 / 8 * 7 <= n)
+        slots *= 2;
+    const double load_factors[] = { 0.5, 0.625, 0.75, 0.875 };
+    printf("\n== Lookups by swiss table load factor (%d slots)\n", slots);
+    for (int i = 0; i < 4; i++){
+        int keys = (int)(load_factors[i] * slots);
+        printf("  load factor %.3f, %d keys\n", load_factors[i], keys);
+        bench_lookups("chaining", HT_CHAINING, hits, misses, keys);
+        bench_lookups("swiss", HT_SWISS, hits, misses, keys);
+    }
+
+    free(hits);
+    free(misses);
+    return 0;
+}
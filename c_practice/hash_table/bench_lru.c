@@ -0,0 +1,124 @@
+/*
+ * This is a small program that measures the hit rate and throughput of the
+ * LRU cache under Zipfian key streams, where a few keys are requested far
+ * more often than the rest.  Run it as `./bench_lru [num_requests]`.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#include "lru.h"
+
+/*
+ * Number of distinct keys requests are drawn from.
+ */
+#define NUM_KEYS (1 << 20)
+
+/*
+ * This is a convert function to be used to convert the integer key
+ */
+int convert_int(void* key){
+    int *k = key;
+    return *k;
+}
+
+/*
+ * This function returns the current time in seconds from a monotonic clock.
+ */
+double now(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * This function returns a pseudo-random number in [0, 1) from a xorshift
+ * generator, so the stream is the same on every run.
+ */
+double next_uniform(unsigned long long* state){
+    unsigned long long x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return (x >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/*
+ * This function fills `stream` with `n` key indices drawn from a Zipfian
+ * distribution with exponent `s` over NUM_KEYS keys: key i is requested in
+ * proportion to 1 / (i + 1)^s.  Ranks are scattered over the key space so
+ * popular keys are not neighbours.
+ */
+void zipf_stream(int* stream, int n, double s){
+    double* cdf = malloc(NUM_KEYS * sizeof(double));
+    unsigned long long state = 88172645463325252ULL;
+    double sum = 0;
+
+    for (int i = 0; i < NUM_KEYS; i++){
+        sum += 1.0 / pow(i + 1, s);
+        cdf[i] = sum;
+    }
+    for (int i = 0; i < n; i++){
+        double u = next_uniform(&state) * sum;
+        int lo = 0, hi = NUM_KEYS - 1;
+        while (lo < hi){
+            int mid = (lo + hi) / 2;
+            if (cdf[mid] < u)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        stream[i] = (int)(((unsigned int)lo * 2654435761u) & (NUM_KEYS - 1));
+    }
+    free(cdf);
+}
+
+/*
+ * This function replays a stream against a cache of `capacity` entries the
+ * way a read-through cache is used: every miss is followed by a put.
+ */
+void bench_cache(int* keys, int* stream, int n, int capacity){
+    struct lru* c = lru_create(capacity, convert_int);
+    struct lru_stats stats;
+    double start, secs;
+
+    start = now();
+    for (int i = 0; i < n; i++){
+        int* k = &keys[stream[i]];
+        if (lru_get(c, k) == NULL)
+            lru_put(c, k, k);
+    }
+    secs = now() - start;
+    lru_stats(c, &stats);
+    printf("  capacity %8d   hit rate %6.2f%%   %8.2f Mops/s   evictions %ld\n",
+        capacity, 100.0 * stats.hits / n, n / secs / 1e6, stats.evictions);
+    lru_free(c);
+}
+
+int main(int argc, char** argv){
+    int n = argc > 1 ? atoi(argv[1]) : 1 << 22;
+    int* keys = malloc(NUM_KEYS * sizeof(int));
+    int* stream = malloc(n * sizeof(int));
+    const double exponents[] = { 0.8, 0.99, 1.2 };
+    const int capacities[] = { NUM_KEYS / 1000, NUM_KEYS / 100, NUM_KEYS / 10 };
+
+    for (int i = 0; i < NUM_KEYS; i++)
+        keys[i] = i;
+
+    printf("Replaying %d requests over %d keys...\n", n, NUM_KEYS);
+    for (int e = 0; e < 3; e++){
+        zipf_stream(stream, n, exponents[e]);
+        printf("\n== Zipf s = %.2f\n", exponents[e]);
+        for (int i = 0; i < 3; i++)
+            bench_cache(keys, stream, n, capacities[i]);
+    }
+
+    free(keys);
+    free(stream);
+    return 0;
+}
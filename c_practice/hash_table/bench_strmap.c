@@ -0,0 +1,158 @@
+/*
+ * This is a small program that compares the string map with a plain hash
+ * table keyed by strings the caller copies with strdup(), hashed with
+ * ht_hash_string and compared with strcmp.  A stream of keys with repeats is
+ * added, every key is counted and then looked up again.  Run it as
+ * `./bench_strmap [num_keys]`.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#include "hash_table.h"
+#include "hashers.h"
+#include "strmap.h"
+
+/*
+ * Every distinct key appears this many times in the stream on average.
+ */
+#define REPEATS 4
+
+/*
+ * This function returns the current time in seconds from a monotonic clock.
+ */
+double now(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * This function returns the number of bytes currently allocated by malloc,
+ * or 0 where the C library cannot tell.
+ */
+size_t heap_in_use(){
+#ifdef __GLIBC__
+    // large arrays are mapped on their own and not part of uordblks
+    struct mallinfo2 mi = mallinfo2();
+    return mi.uordblks + mi.hblkhd;
+#else
+    return 0;
+#endif
+}
+
+/*
+ * This function compares two string keys, returning 0 if they are equal
+ */
+int cmp_str(void* a, void* b){
+    return strcmp(a, b);
+}
+
+/*
+ * This function counts the keys of the stream in a hash table whose keys
+ * are copied with strdup() when they are first seen.  The count of a key is
+ * stored in the value pointer itself.
+ */
+void bench_ht(char** stream, int len, char** keys, int n){
+    size_t base = heap_in_use();
+    struct ht* ht = ht_create_type(HT_SWISS);
+    ht_set_key_cmp(ht, cmp_str);
+    double start = now();
+    for (int i = 0; i < len; i++){
+        void* count = ht_lookup(ht, stream[i], ht_hash_string);
+        char* key = count ? stream[i] : strdup(stream[i]);
+        ht_insert(ht, key, (void*)((intptr_t)count + 1), ht_hash_string);
+    }
+    double add = now() - start;
+    size_t bytes = heap_in_use() - base;
+
+    start = now();
+    long total = 0;
+    for (int i = 0; i < n; i++)
+        total += (intptr_t)ht_lookup(ht, keys[i], ht_hash_string);
+    double lookup = now() - start;
+    printf("  %-22s add %6.2f Mkeys/s   lookup %6.2f Mkeys/s   %5.1f bytes/key   total %ld\n",
+        "ht + strdup", len / add / 1e6, n / lookup / 1e6, (double)bytes / n, total);
+
+    // the table does not own its keys, they are freed by walking it
+    start = now();
+    unsigned int cursor = 0;
+    struct ht_entry entries[256];
+    do {
+        int got = ht_scan(ht, &cursor, 256, entries);
+        for (int i = 0; i < got; i++)
+            free(entries[i].key);
+    } while (cursor != 0);
+    ht_free(ht);
+    printf("  %-22s free %8.3f ms\n", "", (now() - start) * 1e3);
+}
+
+/*
+ * This function counts the keys of the stream in a string map.
+ */
+void bench_strmap(char** stream, int len, char** keys, int n){
+    size_t base = heap_in_use();
+    struct strmap* m = strmap_create(HT_SWISS);
+    double start = now();
+    for (int i = 0; i < len; i++){
+        size_t klen = strlen(stream[i]);
+        void* count = strmap_get(m, stream[i], klen);
+        strmap_put(m, stream[i], klen, (void*)((intptr_t)count + 1));
+    }
+    double add = now() - start;
+    size_t bytes = heap_in_use() - base;
+
+    start = now();
+    long total = 0;
+    for (int i = 0; i < n; i++)
+        total += (intptr_t)strmap_get(m, keys[i], strlen(keys[i]));
+    double lookup = now() - start;
+    printf("  %-22s add %6.2f Mkeys/s   lookup %6.2f Mkeys/s   %5.1f bytes/key   total %ld\n",
+        "strmap", len / add / 1e6, n / lookup / 1e6, (double)bytes / n, total);
+    start = now();
+    strmap_free(m);
+    printf("  %-22s free %8.3f ms\n", "", (now() - start) * 1e3);
+}
+
+int main(int argc, char** argv){
+    int n = argc > 1 ? atoi(argv[1]) : 1 << 20;
+    int len = n * REPEATS;
+    char** keys = malloc(n * sizeof(char*));
+    char** stream = malloc(len * sizeof(char*));
+    unsigned long long x = 88172645463325252ULL;
+    char buf[64];
+
+    /*
+     * URL-like keys of 20 to 40 bytes.  The stream holds every key once and
+     * then random keys, so every key is counted at least once.
+     */
+    for (int i = 0; i < n; i++){
+        sprintf(buf, "/api/v%d/items/%08x/%s", i % 3, (unsigned int)i * 2654435761u,
+            i % 2 ? "details" : "reviews?page=1");
+        keys[i] = strdup(buf);
+    }
+    for (int i = 0; i < len; i++){
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        stream[i] = keys[i < n ? i : (int)(x % n)];
+    }
+
+    printf("Counting %d keys over a stream of %d...\n", n, len);
+    bench_ht(stream, len, keys, n);
+    bench_strmap(stream, len, keys, n);
+
+    for (int i = 0; i < n; i++)
+        free(keys[i]);
+    free(keys);
+    free(stream);
+    return 0;
+}
@@ -0,0 +1,163 @@
+/*
+ * This file contains a blocked Bloom filter.  The filter is split into
+ * blocks of one 64-byte cache line and every hash code only ever touches
+ * the bits of one block, so a query costs a single cache miss no matter how
+ * many bits it checks.  Inside a block each of the 8 64-bit words holds one
+ * of the hash code's bits, picked with a different odd multiplier per word
+ * (the "split block" layout of Parquet and Impala).  A filter never reports
+ * an added hash code as missing, but it may report a hash code that was
+ * never added as present.  Bits cannot be cleared, so a filter whose hash
+ * codes were removed from its table has to be rebuilt to become tight
+ * again.  See the documentation below for more information on the
+ * individual functions in this implementation.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+
+#include "hashers.h"
+#include "bloom.h"
+
+/*
+ * Number of 64-bit words in a block, one bit is set in each of them, and the
+ * number of filter bits spent per key the filter is sized for.  With 10 bits
+ * a key about 1 in 100 missing hash codes passes the filter.
+ */
+#define BLOOM_WORDS 8
+#define BLOOM_BITS_PER_KEY 10
+
+/*
+ * This structure represents a filter.  `num_blocks` is a power of two and
+ * `blocks` is aligned to a cache line.
+ */
+struct bloom {
+    uint64_t* blocks;
+    int num_blocks;
+};
+
+/*
+ * Odd multipliers that pick the bit of every word of a block.
+ */
+static const uint32_t _bloom_salt[BLOOM_WORDS] = {
+    0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du,
+    0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u
+};
+
+/*
+ * Auxilliary function that spreads a hash code over 64 bits, the high half
+ * picks the block and the low half the bits inside it.  Table hash codes
+ * are already mixed, but their low bits also pick the bucket, so they are
+ * mixed again to keep the filter independent of the bucket layout.
+ */
+static uint64_t _bloom_mix(unsigned int hash) {
+    return hash_mix64(hash);
+}
+
+/*
+ * Auxilliary function that returns the block of a mixed hash code.
+ */
+static uint64_t* _bloom_block(struct bloom* b, uint64_t h) {
+    return b->blocks + (size_t)((uint32_t)(h >> 32) & (b->num_blocks - 1)) * BLOOM_WORDS;
+}
+
+/*
+ * This function allocates an empty filter sized for `n` hash codes and
+ * returns a pointer to it.  The number of blocks is rounded up to a power
+ * of two, so the filter may get up to twice the bits it asked for.
+ *
+ * Params:
+ *   n - the number of hash codes the filter is expected to hold.
+ */
+struct bloom* bloom_create(int n) {
+    assert(n >= 0);
+    struct bloom* b = malloc(sizeof(struct bloom));
+    assert(b);
+    long long bits = (long long)n * BLOOM_BITS_PER_KEY;
+    b->num_blocks = 1;
+    while ((long long)b->num_blocks * BLOOM_WORDS * 64 < bits) {
+        b->num_blocks *= 2;
+    }
+    void* blocks = NULL;
+    size_t bytes = (size_t)b->num_blocks * BLOOM_WORDS * sizeof(uint64_t);
+    int err = posix_memalign(&blocks, 64, bytes);
+    assert(err == 0);
+    (void)err;
+    memset(blocks, 0, bytes);
+    b->blocks = blocks;
+    return b;
+}
+
+/*
+ * This function frees the memory associated with a filter.
+ *
+ * Params:
+ *   b - the filter to be destroyed.  May not be NULL.
+ */
+void bloom_free(struct bloom* b) {
+    assert(b);
+    free(b->blocks);
+    free(b);
+}
+
+/*
+ * This function adds a hash code to a filter.
+ *
+ * Params:
+ *   b - the filter.  May not be NULL.
+ *   hash - the hash code to add.
+ */
+void bloom_add(struct bloom* b, unsigned int hash) {
+    uint64_t h = _bloom_mix(hash);
+    uint64_t* block = _bloom_block(b, h);
+    for (int i = 0; i < BLOOM_WORDS; i++) {
+        block[i] |= (uint64_t)1 << (((uint32_t)h * _bloom_salt[i]) >> 26);
+    }
+}
+
+/*
+ * This function checks whether a hash code may have been added to a
+ * filter.
+ *
+ * Params:
+ *   b - the filter.  May not be NULL.
+ *   hash - the hash code to check.
+ *
+ * Return:
+ *   This function returns 0 if the hash code was certainly never added and
+ *   1 if it may have been.
+ */
+int bloom_may_contain(struct bloom* b, unsigned int hash) {
+    uint64_t h = _bloom_mix(hash);
+    uint64_t* block = _bloom_block(b, h);
+    uint64_t missing = 0;
+    // check every word without branching, the block is in cache after the
+    // first one anyway
+    for (int i = 0; i < BLOOM_WORDS; i++) {
+        missing |= ~block[i] & ((uint64_t)1 << (((uint32_t)h * _bloom_salt[i]) >> 26));
+    }
+    return missing == 0;
+}
+
+/*
+ * This function asks the CPU to start loading the block of a hash code, so
+ * a query that follows shortly after does not wait for memory.
+ *
+ * Params:
+ *   b - the filter that will be queried.  May not be NULL.
+ *   hash - the hash code that will be checked.
+ */
+void bloom_prefetch(struct bloom* b, unsigned int hash) {
+    __builtin_prefetch(_bloom_block(b, _bloom_mix(hash)));
+}
+
+/*
+ * This function returns the number of bytes of filter bits.
+ */
+size_t bloom_bytes(struct bloom* b) {
+    assert(b);
+    return (size_t)b->num_blocks * BLOOM_WORDS * sizeof(uint64_t);
+}
@@ -0,0 +1,30 @@
+/*
+ * This file contains the definition of the interface for a blocked Bloom
+ * filter over 32-bit hash codes.  Hash tables keep one next to their
+ * entries to turn away lookups of missing keys without probing.  You can
+ * find descriptions of the functions, including their parameters and their
+ * return values, in bloom.c.
+ */
+
+#ifndef __BLOOM_H
+#define __BLOOM_H
+
+#include <stddef.h>
+
+/*
+ * Structure used to represent a Bloom filter.
+ */
+struct bloom;
+
+/*
+ * Bloom filter interface function prototypes.  Refer to bloom.c for
+ * documentation about each of these functions.
+ */
+struct bloom* bloom_create(int n);
+void bloom_free(struct bloom* b);
+void bloom_add(struct bloom* b, unsigned int hash);
+int bloom_may_contain(struct bloom* b, unsigned int hash);
+void bloom_prefetch(struct bloom* b, unsigned int hash);
+size_t bloom_bytes(struct bloom* b);
+
+#endif
@@ -0,0 +1,436 @@
+/*
+ * This file contains a chained hash table that can be shared between
+ * threads.  The buckets are split into CHT_STRIPES stripes and a writer only
+ * locks the stripe its key falls into, so writers on different stripes run
+ * in parallel.  Readers never lock: every pointer they follow is published
+ * with a release store, and nodes are never changed in a way a reader could
+ * observe half done.  A removed node is only freed once every reader that
+ * might still be looking at it has finished (see _cht_synchronize()).  See
+ * the documentation below for more information on the individual functions
+ * in this implementation.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "concurrent_ht.h"
+#include "hashers.h"
+
+/*
+ * CHT_INIT_BUCKETS must be a power of two and at least CHT_STRIPES, so that
+ * the stripe of a bucket never changes when the bucket array doubles.
+ * Removed nodes are freed in batches of CHT_RETIRE_BATCH.
+ */
+#define CHT_STRIPES 64
+#define CHT_INIT_BUCKETS 64
+#define CHT_READER_SLOTS 64
+#define CHT_RETIRE_BATCH 1024
+#define CHT_CACHE_LINE 64
+
+/*
+ * This structure represents a single entry.  `key` and `hash` never change
+ * after the node is published.  `retired_next` links removed nodes while
+ * they wait to be freed, `next` is left alone so readers that are standing
+ * on a removed node can still walk off it.
+ */
+struct cht_node {
+    void* key;
+    void* value;
+    unsigned int hash;
+    struct cht_node* next;
+    struct cht_node* retired_next;
+};
+
+/*
+ * This structure represents one bucket array.  A resize builds a new one and
+ * publishes it in a single pointer store.
+ */
+struct cht_table {
+    int num_buckets;
+    struct cht_node* buckets[];
+};
+
+/*
+ * Stripe locks and reader counters are padded to a cache line each so that
+ * threads using different ones do not slow each other down.
+ */
+union cht_stripe {
+    pthread_mutex_t lock;
+    char pad[CHT_CACHE_LINE];
+};
+
+union cht_reader_slot {
+    long count[2];
+    char pad[CHT_CACHE_LINE];
+};
+
+/*
+ * This structure represents the whole table.  `epoch` and the reader slots
+ * implement the grace periods that decide when removed nodes and old bucket
+ * arrays can be freed.  Each thread counts itself into one reader slot, in
+ * the counter picked by the parity of `epoch` when it started reading.
+ */
+struct cht {
+    struct cht_table* table;
+    int size;
+    int (*key_cmp)(void* a, void* b);
+    union cht_stripe stripes[CHT_STRIPES];
+
+    unsigned long epoch;
+    union cht_reader_slot readers[CHT_READER_SLOTS];
+    pthread_mutex_t sync_lock;
+
+    pthread_mutex_t retire_lock;
+    struct cht_node* retired;
+    int num_retired;
+};
+
+/*
+ * The reader slot of the calling thread, picked round robin the first time
+ * the thread reads from any table.
+ */
+static __thread int cht_thread_slot = -1;
+static int cht_next_slot = 0;
+
+/*
+ * Auxilliary function that allocates a bucket array with every bucket empty.
+ */
+static struct cht_table* _cht_table_create(int num_buckets) {
+    struct cht_table* t = calloc(1, sizeof(struct cht_table) +
+        num_buckets * sizeof(struct cht_node*));
+    assert(t);
+    t->num_buckets = num_buckets;
+    return t;
+}
+
+/*
+ * Auxilliary function that frees a bucket array together with every node
+ * still linked into it.
+ */
+static void _cht_table_free(struct cht_table* t) {
+    for (int i = 0; i < t->num_buckets; i++) {
+        struct cht_node* next, * curr = t->buckets[i];
+        while (curr) {
+            next = curr->next;
+            free(curr);
+            curr = next;
+        }
+    }
+    free(t);
+}
+
+/*
+ * Auxilliary function that marks the calling thread as reading.  It returns
+ * the reader slot used and stores the counter parity in `parity`.  If the
+ * epoch changes between picking the parity and counting in, the count is
+ * undone and the thread retries, so a writer that has moved to a new epoch
+ * never misses a reader of the old one.
+ */
+static union cht_reader_slot* _cht_read_begin(struct cht* cht, int* parity) {
+    if (cht_thread_slot < 0) {
+        cht_thread_slot = __atomic_fetch_add(&cht_next_slot, 1, __ATOMIC_RELAXED)
+            % CHT_READER_SLOTS;
+    }
+    union cht_reader_slot* slot = &cht->readers[cht_thread_slot];
+
+    for (;;) {
+        unsigned long p = __atomic_load_n(&cht->epoch, __ATOMIC_SEQ_CST) & 1;
+        __atomic_fetch_add(&slot->count[p], 1, __ATOMIC_SEQ_CST);
+        if ((__atomic_load_n(&cht->epoch, __ATOMIC_SEQ_CST) & 1) == p) {
+            *parity = (int)p;
+            return slot;
+        }
+        __atomic_fetch_sub(&slot->count[p], 1, __ATOMIC_RELEASE);
+    }
+}
+
+/*
+ * Auxilliary function that marks the calling thread as done reading.
+ */
+static void _cht_read_end(union cht_reader_slot* slot, int parity) {
+    __atomic_fetch_sub(&slot->count[parity], 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * Auxilliary function that waits for a grace period: it moves the table to
+ * the next epoch and waits until no reader that started in the previous one
+ * is still reading.  Anything that was unlinked before the call can be freed
+ * once it returns.  Only the writer calling it waits, readers never do.
+ */
+static void _cht_synchronize(struct cht* cht) {
+    pthread_mutex_lock(&cht->sync_lock);
+    unsigned long p = __atomic_fetch_add(&cht->epoch, 1, __ATOMIC_SEQ_CST) & 1;
+    for (int i = 0; i < CHT_READER_SLOTS; i++) {
+        while (__atomic_load_n(&cht->readers[i].count[p], __ATOMIC_ACQUIRE)) {
+            sched_yield();
+        }
+    }
+    pthread_mutex_unlock(&cht->sync_lock);
+}
+
+/*
+ * Auxilliary function that hands a removed node over to be freed.  Nodes are
+ * collected and freed a batch at a time, so a grace period is only waited
+ * for once every CHT_RETIRE_BATCH removals.
+ */
+static void _cht_retire(struct cht* cht, struct cht_node* node) {
+    struct cht_node* batch = NULL;
+
+    pthread_mutex_lock(&cht->retire_lock);
+    node->retired_next = cht->retired;
+    cht->retired = node;
+    if (++cht->num_retired >= CHT_RETIRE_BATCH) {
+        batch = cht->retired;
+        cht->retired = NULL;
+        cht->num_retired = 0;
+    }
+    pthread_mutex_unlock(&cht->retire_lock);
+
+    if (batch) {
+        _cht_synchronize(cht);
+        while (batch) {
+            struct cht_node* next = batch->retired_next;
+            free(batch);
+            batch = next;
+        }
+    }
+}
+
+/*
+ * This function allocates and initializes a new, empty concurrent hash table
+ * and returns a pointer to it.
+ */
+struct cht* cht_create() {
+    struct cht* cht = malloc(sizeof(struct cht));
+    assert(cht);
+    cht->table = _cht_table_create(CHT_INIT_BUCKETS);
+    cht->size = 0;
+    cht->key_cmp = NULL;
+    for (int i = 0; i < CHT_STRIPES; i++) {
+        pthread_mutex_init(&cht->stripes[i].lock, NULL);
+    }
+    cht->epoch = 0;
+    for (int i = 0; i < CHT_READER_SLOTS; i++) {
+        cht->readers[i].count[0] = 0;
+        cht->readers[i].count[1] = 0;
+    }
+    pthread_mutex_init(&cht->sync_lock, NULL);
+    pthread_mutex_init(&cht->retire_lock, NULL);
+    cht->retired = NULL;
+    cht->num_retired = 0;
+    return cht;
+}
+
+/*
+ * This function frees the memory associated with a concurrent hash table.
+ * No other thread may be using the table anymore.  Keys and values stored in
+ * the table are owned by the caller and are not freed.
+ *
+ * Params:
+ *   cht - the table to be destroyed.  May not be NULL.
+ */
+void cht_free(struct cht* cht) {
+    assert(cht);
+    _cht_table_free(cht->table);
+    while (cht->retired) {
+        struct cht_node* next = cht->retired->retired_next;
+        free(cht->retired);
+        cht->retired = next;
+    }
+    for (int i = 0; i < CHT_STRIPES; i++) {
+        pthread_mutex_destroy(&cht->stripes[i].lock);
+    }
+    pthread_mutex_destroy(&cht->sync_lock);
+    pthread_mutex_destroy(&cht->retire_lock);
+    free(cht);
+}
+
+/*
+ * This function sets the function used to tell two keys with the same hash
+ * code apart, see ht_set_key_cmp().  It must be called before the table is
+ * shared between threads.
+ *
+ * Params:
+ *   cht - the table to configure.  May not be NULL.
+ *   cmp - returns 0 if two keys are equal, or NULL if equal hash codes mean
+ *     equal keys.
+ */
+void cht_set_key_cmp(struct cht* cht, int (*cmp)(void* a, void* b)) {
+    assert(cht);
+    cht->key_cmp = cmp;
+}
+
+/*
+ * This function returns the number of elements stored in the table.  While
+ * other threads are writing the result is only a snapshot.
+ */
+int cht_size(struct cht* cht) {
+    assert(cht);
+    return __atomic_load_n(&cht->size, __ATOMIC_RELAXED);
+}
+
+/*
+ * This function returns 1 if the table is empty and 0 otherwise.
+ */
+int cht_isempty(struct cht* cht) {
+    return cht_size(cht) == 0;
+}
+
+/*
+ * Auxilliary function that doubles the bucket array.  All stripe locks are
+ * taken, so writers wait, but readers carry on using the old bucket array
+ * while the new one is built.  Nodes are copied rather than moved, so the
+ * old array stays intact for those readers until a grace period has passed
+ * and it can be freed.
+ */
+static void _cht_resize(struct cht* cht) {
+    for (int i = 0; i < CHT_STRIPES; i++) {
+        pthread_mutex_lock(&cht->stripes[i].lock);
+    }
+
+    struct cht_table* old = cht->table;
+    /*
+     * Another writer may have resized the table while we waited for the
+     * locks.
+     */
+    if (cht->size < 4 * old->num_buckets) {
+        for (int i = CHT_STRIPES - 1; i >= 0; i--) {
+            pthread_mutex_unlock(&cht->stripes[i].lock);
+        }
+        return;
+    }
+
+    struct cht_table* t = _cht_table_create(old->num_buckets * 2);
+    int mask = t->num_buckets - 1;
+    for (int i = 0; i < old->num_buckets; i++) {
+        for (struct cht_node* curr = old->buckets[i]; curr; curr = curr->next) {
+            struct cht_node* node = malloc(sizeof(struct cht_node));
+            assert(node);
+            int idx = hash_mix32(curr->hash) & mask;
+            node->key = curr->key;
+            node->value = curr->value;
+            node->hash = curr->hash;
+            node->next = t->buckets[idx];
+            t->buckets[idx] = node;
+        }
+    }
+    __atomic_store_n(&cht->table, t, __ATOMIC_RELEASE);
+
+    for (int i = CHT_STRIPES - 1; i >= 0; i--) {
+        pthread_mutex_unlock(&cht->stripes[i].lock);
+    }
+
+    _cht_synchronize(cht);
+    _cht_table_free(old);
+}
+
+/*
+ * This function inserts a key/value pair into the table, or replaces the
+ * value if the key is already there.  Only the stripe of the key is locked.
+ * The bucket array is doubled when the load factor reaches 4.
+ *
+ * Params:
+ *   cht - the table into which to insert.  May not be NULL.
+ *   key - the key of the element.
+ *   value - the value to be stored.
+ *   convert - converts the key to its hash code.
+ */
+void cht_insert(struct cht* cht, void* key, void* value, int (*convert)(void*)) {
+    assert(cht);
+    unsigned int hash = convert(key);
+    unsigned int mixed = hash_mix32(hash);
+    pthread_mutex_t* lock = &cht->stripes[mixed % CHT_STRIPES].lock;
+
+    pthread_mutex_lock(lock);
+    struct cht_table* t = cht->table;
+    struct cht_node** bucket = &t->buckets[mixed & (t->num_buckets - 1)];
+    for (struct cht_node* curr = *bucket; curr; curr = curr->next) {
+        if (curr->hash == hash && (cht->key_cmp == NULL || cht->key_cmp(key, curr->key) == 0)) {
+            __atomic_store_n(&curr->value, value, __ATOMIC_RELEASE);
+            pthread_mutex_unlock(lock);
+            return;
+        }
+    }
+
+    struct cht_node* node = malloc(sizeof(struct cht_node));
+    assert(node);
+    node->key = key;
+    node->value = value;
+    node->hash = hash;
+    node->next = *bucket;
+    __atomic_store_n(bucket, node, __ATOMIC_RELEASE);
+    int size = __atomic_add_fetch(&cht->size, 1, __ATOMIC_RELAXED);
+    int num_buckets = t->num_buckets;
+    pthread_mutex_unlock(lock);
+
+    // `t` may be freed by another writer's resize once the lock is released
+    if (size >= 4 * num_buckets) {
+        _cht_resize(cht);
+    }
+}
+
+/*
+ * This function returns the value stored under a key, or NULL if the key is
+ * not in the table.  It never blocks.
+ *
+ * Params:
+ *   cht - the table to search.  May not be NULL.
+ *   key - the key to search for.
+ *   convert - converts the key to its hash code.
+ */
+void* cht_lookup(struct cht* cht, void* key, int (*convert)(void*)) {
+    assert(cht);
+    unsigned int hash = convert(key);
+    unsigned int mixed = hash_mix32(hash);
+    void* value = NULL;
+    int parity;
+
+    union cht_reader_slot* slot = _cht_read_begin(cht, &parity);
+    struct cht_table* t = __atomic_load_n(&cht->table, __ATOMIC_ACQUIRE);
+    struct cht_node* curr = __atomic_load_n(&t->buckets[mixed & (t->num_buckets - 1)],
+        __ATOMIC_ACQUIRE);
+    while (curr) {
+        if (curr->hash == hash && (cht->key_cmp == NULL || cht->key_cmp(key, curr->key) == 0)) {
+            value = __atomic_load_n(&curr->value, __ATOMIC_ACQUIRE);
+            break;
+        }
+        curr = __atomic_load_n(&curr->next, __ATOMIC_ACQUIRE);
+    }
+    _cht_read_end(slot, parity);
+    return value;
+}
+
+/*
+ * This function removes the element stored under a key, if any.  The node is
+ * unlinked right away but only freed after a grace period, because readers
+ * may still be walking over it.
+ *
+ * Params:
+ *   cht - the table from which to remove.  May not be NULL.
+ *   key - the key of the element to remove.
+ *   convert - converts the key to its hash code.
+ */
+void cht_remove(struct cht* cht, void* key, int (*convert)(void*)) {
+    assert(cht);
+    unsigned int hash = convert(key);
+    unsigned int mixed = hash_mix32(hash);
+    pthread_mutex_t* lock = &cht->stripes[mixed % CHT_STRIPES].lock;
+
+    pthread_mutex_lock(lock);
+    struct cht_table* t = cht->table;
+    struct cht_node** link = &t->buckets[mixed & (t->num_buckets - 1)];
+    for (struct cht_node* curr = *link; curr; link = &curr->next, curr = curr->next) {
+        if (curr->hash == hash && (cht->key_cmp == NULL || cht->key_cmp(key, curr->key) == 0)) {
+            __atomic_store_n(link, curr->next, __ATOMIC_RELEASE);
+            __atomic_sub_fetch(&cht->size, 1, __ATOMIC_RELAXED);
+            pthread_mutex_unlock(lock);
+            _cht_retire(cht, curr);
+            return;
+        }
+    }
+    pthread_mutex_unlock(lock);
+}
@@ -0,0 +1,29 @@
+/*
+ * This file contains the definition of the interface for a hash table that
+ * can be shared between threads.  Writers lock one stripe of buckets, readers
+ * never take a lock.  You can find descriptions of the functions, including
+ * their parameters and their return values, in concurrent_ht.c.
+ */
+
+#ifndef __CONCURRENT_HT_H
+#define __CONCURRENT_HT_H
+
+/*
+ * Structure used to represent a concurrent hash table.
+ */
+struct cht;
+
+/*
+ * Concurrent hash table interface function prototypes.  Refer to
+ * concurrent_ht.c for documentation about each of these functions.
+ */
+struct cht* cht_create();
+void cht_free(struct cht* cht);
+void cht_set_key_cmp(struct cht* cht, int (*cmp)(void* a, void* b));
+int cht_size(struct cht* cht);
+int cht_isempty(struct cht* cht);
+void cht_insert(struct cht* cht, void* key, void* value, int (*convert)(void*));
+void* cht_lookup(struct cht* cht, void* key, int (*convert)(void*));
+void cht_remove(struct cht* cht, void* key, int (*convert)(void*));
+
+#endif
@@ -8,71 +8,555 @@
  * Email:velascod@oregonstate.edu
  */
 
+#define _POSIX_C_SOURCE 199309L
+
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
 #include <assert.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
-#include "dynarray.h"
 #include "list.h"
+#include "node_pool.h"
+#include "robin_hood.h"
+#include "swiss_table.h"
+#include "snapshot.h"
+#include "hashers.h"
+#include "bloom.h"
+#include "worker_pool.h"
 #include "hash_table.h"
 
 
+/*
+ * Largest number of entries a table keeps inline, in the arrays of the ht
+ * structure itself, before it sets up its storage engine.  The inline hash
+ * codes are compared 4 at a time, so this is a multiple of 4.
+ */
+#define HT_SMALL_MAX 8
+
 /*
  * This is the structure that represents a hash table.  You must define
  * this struct to contain the data needed to implement a hash table.
  */
-// hash table, collision resolution with chaining
+// hash table, collision resolution with chaining or, for HT_ROBIN_HOOD and
+// HT_SWISS tables, with the open-addressing engines in robin_hood.c and
+// swiss_table.c, HT_MAPPED tables are read-only snapshots from snapshot.c
+// buckets is an array of list heads, a bucket takes no memory of its own
+// until an entry is inserted into it
+// while a resize is in progress old_buckets holds the previous bucket array,
+// every old bucket below rehash_idx has already been moved to buckets
+// chain nodes come from the nodes pool and are released all at once by ht_free
+// workers is NULL unless ht_set_resize_threads was called, resizes then move
+// every bucket at once on its threads instead of a few buckets per call
+// stats is NULL unless statistics were turned on with ht_enable_stats
+// filter is NULL unless the Bloom filter was turned on with ht_enable_bloom,
+// it was built for filter_cap buckets or slots and sized for filter_keys
+// entries, filter_load counts the entries added to it since then, removed
+// entries included
+// next_filter is the filter that replaces filter once a chained table has
+// added every bucket below next_idx to it, it is NULL unless one is filling
+// a new table starts out small: it has no engine yet and its size entries
+// are kept in small_hashes, small_keys and small_values, the first insert
+// that does not fit sets up the engine and moves them there for good
 struct ht{
-    struct dynarray* buckets;
+    enum ht_type type;
+    struct list* buckets;
     int num_buckets;
+    int min_buckets;
+    struct list* old_buckets;
+    int old_num_buckets;
+    int rehash_idx;
+    int size;
+    unsigned int seed;
+    int (*key_cmp)(void* a, void* b);
+    struct node_pool* nodes;
+    struct worker_pool* workers;
+    struct rh_table* rh;
+    struct sw_table* sw;
+    struct snapshot* snap;
+    struct ht_counters* stats;
+    struct bloom* filter;
+    int filter_cap;
+    int filter_keys;
+    int filter_load;
+    struct bloom* next_filter;
+    int next_idx;
+    int small;
+    unsigned int small_hashes[HT_SMALL_MAX];
+    void* small_keys[HT_SMALL_MAX];
+    void* small_values[HT_SMALL_MAX];
+};
+
+// counters kept while statistics are turned on, cap_before and op_start
+// remember the capacity and time before an open-addressing insert or remove
+struct ht_counters{
+    long hits;
+    long misses;
+    long long hit_probes;
+    long long miss_probes;
+    int max_hit;
+    int max_miss;
+    int max_filter;
+    long resizes;
+    long long resize_ns;
+    int cap_before;
+    long long op_start;
 };
 
 
 /*====================================================================================================*/
 
+/*
+ * Number of old buckets moved into the new bucket array by every insert,
+ * lookup and remove while a resize is in progress.
+ */
+#define HT_REHASH_STEP 4
+
+void insert_hashed(struct ht* ht, void* key, void* value, unsigned int hash);
+void* lookup_hashed(struct ht* ht, void* key, unsigned int hash);
+void* find_hashed(struct ht* ht, void* key, unsigned int hash);
+void count_lookup(struct ht* ht, void* key, unsigned int hash, int hit);
+void store_hashed(struct ht* ht, void* key, void* value, unsigned int hash);
+void* upsert_hashed(struct ht* ht, void* key, unsigned int hash, void* (*init)(void* key, void* arg),
+        void* (*update)(void* value, void* arg), void* arg);
+void remove_hashed(struct ht* ht, void* key, unsigned int hash);
+void filter_add(struct ht* ht, unsigned int hash);
+void filter_update(struct ht* ht);
+void for_each_entry(struct ht* ht, void (*fn)(void* arg, void* key, void* value, unsigned int hash),
+        void* arg);
+int ht_capacity(struct ht* ht);
+void leave_small(struct ht* ht);
+int small_find(struct ht* ht, void* key, unsigned int hash);
+int small_append(struct ht* ht, void* key, unsigned int hash);
+void** small_upsert(struct ht* ht, void* key, unsigned int hash, int* created);
+void** engine_upsert(struct ht* ht, void* key, unsigned int hash, int* created);
+
+/*
+ * Smallest number of buckets of a chained table, tables shrink back down to
+ * it (or to the capacity they were created with) once they empty out.
+ */
+#define HT_MIN_BUCKETS 2
+
+/*
+ * Smallest old bucket array that resize threads split between them, smaller
+ * ones are moved by the calling thread alone.
+ */
+#define HT_PARALLEL_MIN_BUCKETS (1 << 14)
+
+/*
+ * Function Name: key_hash
+ * Description: This function returns the hash code a table stores for a key,
+ *              every engine is handed this code instead of convert's result.
+ *              convert's result is combined with the table's seed and then
+ *              scrambled so every bit depends on every input bit.  convert is
+ *              often the identity on integer keys, but all engines pick
+ *              buckets or slots from a few low or high bits only.  For a
+ *              given seed this is a bijection, so two keys have equal stored
+ *              hash codes exactly when convert gave them equal hash codes
+ * Params:
+ *      ht - the hash table the key belongs to
+ *      key - the key
+ *      convert - converts the key to its hash code
+ * */
+unsigned int key_hash(struct ht* ht, void* key, int (*convert)(void*)){
+    return hash_mix32((unsigned int)convert(key) ^ ht->seed);
+}
+
+/*
+ * Function Name: now_ns
+ * Description: This function returns the time of a monotonic clock in
+ *              nanoseconds, it is only read while statistics are turned on
+ * */
+long long now_ns(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/*
+ * Function Name: random_seed
+ * Description: This function returns a fresh seed for a new table.  It mixes
+ *              the clock, the table's address and a counter, so tables created
+ *              in the same run or in different runs get different seeds
+ * Params:
+ *      ht - the hash table the seed is for
+ * */
+unsigned int random_seed(struct ht* ht){
+    static unsigned long long counter = 0;
+    unsigned long long x = (unsigned long long)time(NULL) ^ ((unsigned long long)clock() << 32)
+        ^ (unsigned long long)(uintptr_t)ht ^ (++counter * 0x9e3779b97f4a7c15ULL);
+    return (unsigned int)hash_mix64(x);
+}
+
+/*
+ * Function Name: bucket_index
+ * Description: This function maps a cached hash code to a bucket index.  The
+ *              number of buckets is always a power of two and the hash code
+ *              is already mixed, so its low bits can be masked off directly
+ * Params:
+ *      hash - the full hash code of a key
+ *      num_buckets - the number of buckets of the bucket array
+ * */
+int bucket_index(unsigned int hash, int num_buckets){
+    return (int)(hash & (unsigned int)(num_buckets - 1));
+}
+
+/*
+ * Function Name: migrate_bucket
+ * Description: This function moves every entry of one bucket of the old
+ *              bucket array into the current bucket array, leaving the old
+ *              bucket empty.  Entries are placed by their cached hash code
+ *              and their nodes are relinked, not copied
+ * Params:
+ *      ht - hash table that is being resized
+ *      idx - index of the bucket in the old bucket array
+ * */
+void migrate_bucket(struct ht* ht, int idx){
+    struct list* old_bucket = list_array_get(ht->old_buckets, idx);
+    void* curr;
+    // reindexing and and inserting occurs here
+    while((curr = head_get(old_bucket))){
+        int new_idx = bucket_index(node_hash(curr), ht->num_buckets);
+        struct list* new_b = list_array_get(ht->buckets, new_idx);
+        list_move_head(old_bucket, new_b);
+    }
+}
+
+/*
+ * Function Name: rehash_step
+ * Description: This function moves up to `steps` buckets from the old bucket
+ *              array into the current one.  Once every old bucket has been
+ *              moved the old bucket array is freed and the resize is over
+ * Params:
+ *      ht - hash table that is being resized
+ *      steps - maximum number of old buckets to move
+ * */
+void rehash_step(struct ht* ht, int steps){
+    if (ht->old_buckets == NULL){
+        return;
+    }
+    // moving buckets is part of the resize, so it counts towards its time
+    long long start = ht->stats ? now_ns() : 0;
+    while (ht->old_buckets && steps-- > 0){
+        migrate_bucket(ht, ht->rehash_idx);
+        ht->rehash_idx++;
+        if (ht->rehash_idx == ht->old_num_buckets){
+            list_array_free(ht->old_buckets, ht->old_num_buckets, ht->nodes);
+            ht->old_buckets = NULL;
+            ht->old_num_buckets = 0;
+        }
+    }
+    if (ht->stats){
+        ht->stats->resize_ns += now_ns() - start;
+    }
+}
+
+/*
+ * Function Name: old_bucket_get
+ * Description: This function returns the bucket of the old bucket array that
+ *              a hash code maps to, or NULL if no resize is in progress.  A
+ *              bucket that has already been migrated is empty
+ * Params:
+ *      ht - hash table that is being resized
+ *      hash - the full hash code of the key whose old bucket is wanted
+ * */
+struct list* old_bucket_get(struct ht* ht, unsigned int hash){
+    if (ht->old_buckets == NULL){
+        return NULL;
+    }
+    return list_array_get(ht->old_buckets, bucket_index(hash, ht->old_num_buckets));
+}
+
+/*
+ * Function Name: migrate_range
+ * Description: This function is run by every resize thread and moves its
+ *              share of the old buckets.  With m the smaller of the old and
+ *              new bucket counts, old bucket i only feeds new buckets that
+ *              are equal to i modulo m (i and i + m when doubling, i - m
+ *              when halving).  Each thread takes a range of residues modulo
+ *              m, so no two threads ever write the same old or new bucket
+ *              and no locks are needed
+ * Params:
+ *      arg - hash table that is being resized
+ *      idx - index of the thread
+ *      threads - number of threads sharing the move
+ * */
+void migrate_range(void* arg, int idx, int threads){
+    struct ht* ht = arg;
+    int old_nb = ht->old_num_buckets;
+    int m = old_nb < ht->num_buckets ? old_nb : ht->num_buckets;
+    int lo = (int)((long long)m * idx / threads);
+    int hi = (int)((long long)m * (idx + 1) / threads);
+
+    for (int i = lo; i < hi; i++){
+        for (int old = i; old < old_nb; old += m){
+            migrate_bucket(ht, old);
+        }
+    }
+}
+
+/*
+ * Function Name: migrate_all
+ * Description: This function finishes a resize right away by moving every
+ *              old bucket that has not been moved yet, split between the
+ *              table's resize threads if the old bucket array is large
+ * Params:
+ *      ht - hash table that is being resized, with resize threads
+ * */
+void migrate_all(struct ht* ht){
+    if (ht->old_buckets == NULL){
+        return;
+    }
+    if (ht->old_num_buckets < HT_PARALLEL_MIN_BUCKETS){
+        rehash_step(ht, ht->old_num_buckets);
+        return;
+    }
+    long long start = ht->stats ? now_ns() : 0;
+    wp_run(ht->workers, migrate_range, ht);
+    list_array_free(ht->old_buckets, ht->old_num_buckets, ht->nodes);
+    ht->old_buckets = NULL;
+    ht->old_num_buckets = 0;
+    if (ht->stats){
+        ht->stats->resize_ns += now_ns() - start;
+    }
+}
+
+/*
+ * Function Name: rebucket
+ * Description: This function replaces the bucket array of a chained table
+ *              with one of `new_nb` empty buckets and starts moving the
+ *              entries over.  The move is spread over the following inserts,
+ *              lookups and removes (HT_REHASH_STEP buckets each) so no single
+ *              call pays for the whole table.  A move that is still in
+ *              progress is finished first
+ * Params:
+ *      ht - hash table whose buckets are replaced
+ *      new_nb - the new number of buckets, a power of two
+ * */
+void rebucket(struct ht* ht, int new_nb){
+    // finish the previous resize so at most two bucket arrays are live
+    if (ht->old_buckets){
+        rehash_step(ht, ht->old_num_buckets);
+    }
+    long long start = ht->stats ? now_ns() : 0;
+    // old_nb keeps track of the old number of buckets
+    int old_nb = ht->num_buckets;
+    ht->num_buckets = new_nb;
+
+    // the new buckets start out as NULL heads, nothing is allocated per bucket
+    struct list* new_buckets = list_array_create(new_nb);
+    // the current buckets become the old buckets, migration starts at 0
+    ht->old_buckets = ht->buckets;
+    ht->old_num_buckets = old_nb;
+    ht->rehash_idx = 0;
+    ht->buckets = new_buckets;
+    // a filter being filled was sized for the old buckets and its position
+    // means nothing in the new ones, filter_update starts over once the
+    // entries have been moved
+    if (ht->next_filter){
+        bloom_free(ht->next_filter);
+        ht->next_filter = NULL;
+    }
+    if (ht->stats){
+        ht->stats->resizes++;
+        ht->stats->resize_ns += now_ns() - start;
+    }
+    // with resize threads the whole move happens now instead of bit by bit
+    if (ht->workers){
+        migrate_all(ht);
+    }
+}
+
+/*
+ * Function Name: stats_begin
+ * Description: This function remembers the capacity of an open-addressed
+ *              table and the time before an insert or remove, the engines
+ *              resize on their own inside those calls
+ * Params:
+ *      ht - hash table with statistics turned on
+ * */
+void stats_begin(struct ht* ht){
+    ht->stats->cap_before = ht_capacity(ht);
+    ht->stats->op_start = now_ns();
+}
+
+/*
+ * Function Name: stats_end
+ * Description: This function counts the operation started by stats_begin as
+ *              a resize if it changed the capacity of the table
+ * Params:
+ *      ht - hash table with statistics turned on
+ * */
+void stats_end(struct ht* ht){
+    if (ht_capacity(ht) != ht->stats->cap_before){
+        ht->stats->resizes++;
+        ht->stats->resize_ns += now_ns() - ht->stats->op_start;
+    }
+}
+
 /*
  * Function Name: resize
- * Description: This function will resize the hash table. The capacity 
- *              of the hash table and updates the values index according 
- *              to the newly updated capacity
+ * Description: This function will resize the hash table. It doubles the
+ *              number of buckets and starts moving the values into the new
+ *              buckets, see rebucket
  * Params: 
  *      ht - hash table that will be resized 
- *      convert - will be used to recieve a new hash function index
+ *      convert - unused, entries are moved by their cached hash codes.  It
+ *                is kept so existing callers do not have to change
  * */
 void resize(struct ht* ht, int(*convert)(void*)){
-    // old_nb keeps track of the old number of buckets
-    int old_nb = ht->num_buckets;
-    //double size of num buckets
-    ht->num_buckets *= 2;    
-    
-    struct dynarray* new_buckets = dynarray_create();
-    /* this first for loop initializes the a new empty hash table */ 
-    for (int i = 0; i < ht->num_buckets; i++){
-        struct list* empty = list_create();
-        dynarray_insert(new_buckets, empty);
-    }
-    /* 
-     * this for loop puts the values of the old hash table and updates index of the values
-     * according to new num buckets
-     * */
-    for (int i = 0; i < old_nb; i++){
-        struct list* old_bucket = dynarray_get(ht->buckets, i);
-        void* curr = head_get(old_bucket);
-        // reindexing and and inserting occurs here
-        while(curr){
-            int idx = ht_hash_func(ht,node_val(curr), convert);
-            struct list* new_b = dynarray_get(new_buckets, idx);
-            list_insert(new_b,node_val(curr));
-            curr = next_node(curr);
-        }
-        list_free(old_bucket);
-    }
-    //free old hash table and sets new hash table
-
-    dynarray_free(ht->buckets);
-    ht->buckets = new_buckets;
+    if (ht->small){
+        leave_small(ht);
+        return;
+    }
+    switch (ht->type){
+    case HT_ROBIN_HOOD:
+        if (ht->stats) stats_begin(ht);
+        rh_grow(ht->rh);
+        if (ht->stats) stats_end(ht);
+        return;
+    case HT_SWISS:
+        if (ht->stats) stats_begin(ht);
+        sw_grow(ht->sw);
+        if (ht->stats) stats_end(ht);
+        return;
+    case HT_MAPPED:
+        return;
+    default:
+        break;
+    }
+    rebucket(ht, ht->num_buckets * 2);
+}
+/*====================================================================================================*/
+
+/*
+ * Function Name: small_match
+ * Description: This function returns a bit mask with bit i set for every
+ *              inline entry i whose hash code equals `hash`.  The 8 inline
+ *              hash codes are compared with two SSE2 instructions
+ * Params:
+ *      ht - a small hash table
+ *      hash - the hash code of a key, see key_hash
+ * */
+unsigned int small_match(struct ht* ht, unsigned int hash){
+    unsigned int mask = 0;
+#ifdef __SSE2__
+    __m128i h = _mm_set1_epi32((int)hash);
+    for (int i = 0; i < HT_SMALL_MAX; i += 4){
+        __m128i codes = _mm_loadu_si128((const __m128i*)(ht->small_hashes + i));
+        unsigned int m = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(codes, h)));
+        mask |= m << i;
+    }
+#else
+    for (int i = 0; i < HT_SMALL_MAX; i++){
+        mask |= (unsigned int)(ht->small_hashes[i] == hash) << i;
+    }
+#endif
+    // slots past the size hold stale hash codes
+    return mask & ((1u << ht->size) - 1);
+}
+
+/*
+ * Function Name: small_find
+ * Description: This function returns the index of the inline entry of a
+ *              key, or -1 if the key is not in a small table
+ * Params:
+ *      ht - a small hash table
+ *      key - the key to search for
+ *      hash - the hash code of the key, see key_hash
+ * */
+int small_find(struct ht* ht, void* key, unsigned int hash){
+    unsigned int mask = small_match(ht, hash);
+    while (mask){
+        int idx = __builtin_ctz(mask);
+        if (ht->key_cmp == NULL || ht->key_cmp(key, ht->small_keys[idx]) == 0){
+            return idx;
+        }
+        mask &= mask - 1;
+    }
+    return -1;
+}
+
+/*
+ * Function Name: small_append
+ * Description: This function adds a key that is not in a small table yet
+ *              after its last inline entry and returns the entry's index,
+ *              the caller sets the value
+ * Params:
+ *      ht - a small hash table with fewer than HT_SMALL_MAX entries
+ *      key - the key to add
+ *      hash - the hash code of the key, see key_hash
+ * */
+int small_append(struct ht* ht, void* key, unsigned int hash){
+    int idx = ht->size++;
+    ht->small_hashes[idx] = hash;
+    ht->small_keys[idx] = key;
+    ht->small_values[idx] = NULL;
+    return idx;
+}
+
+/*
+ * Function Name: small_upsert
+ * Description: This function finds or adds the inline entry of a key and
+ *              returns where its value is stored.  If the key is new and
+ *              every inline entry is taken the table leaves its small mode
+ *              and NULL is returned, the key then goes to the engine
+ * Params:
+ *      ht - a small hash table
+ *      key - the key of the element
+ *      hash - the hash code of the key, see key_hash
+ *      created - set to 1 if the entry was added and to 0 if it existed
+ * */
+void** small_upsert(struct ht* ht, void* key, unsigned int hash, int* created){
+    int idx = small_find(ht, key, hash);
+    *created = idx < 0;
+    if (idx < 0 && ht->size < HT_SMALL_MAX){
+        idx = small_append(ht, key, hash);
+    }
+    if (idx < 0){
+        leave_small(ht);
+        return NULL;
+    }
+    return &ht->small_values[idx];
+}
 
+/*
+ * Function Name: leave_small
+ * Description: This function sets up the storage engine of a small table
+ *              and moves its inline entries into it.  The table stays in
+ *              the engine from then on, even if it empties out again
+ * Params:
+ *      ht - a small hash table
+ * */
+void leave_small(struct ht* ht){
+    int n = ht->size;
+    ht->small = 0;
+    ht->size = 0;
+    switch (ht->type){
+    case HT_ROBIN_HOOD:
+        ht->rh = rh_create();
+        break;
+    case HT_SWISS:
+        ht->sw = sw_create();
+        break;
+    default:
+        ht->nodes = pool_create(list_node_size());
+        // initialize new hash table with empty buckets
+        ht->buckets = list_array_create(ht->min_buckets);
+        ht->num_buckets = ht->min_buckets;
+        break;
+    }
+    // the inline arrays are not touched by the engine, so they can be read
+    // while the entries are stored
+    for (int i = 0; i < n; i++){
+        store_hashed(ht, ht->small_keys[i], ht->small_values[i], ht->small_hashes[i]);
+    }
 }
+
 /*====================================================================================================*/
 
 
@@ -81,17 +565,200 @@ void resize(struct ht* ht, int(*convert)(void*)){
  * return a pointer to it.
  */
 struct ht* ht_create(){
+    return ht_create_type(HT_CHAINING);
+}
+
+/*
+ * This function allocates and initializes an empty hash table that uses the
+ * given storage engine and returns a pointer to it.  All engines support
+ * the whole ht_* interface, so callers only pick the engine here.
+ *
+ * Params:
+ *   type - HT_CHAINING for a table of linked buckets, HT_ROBIN_HOOD for a
+ *     flat open-addressed table or HT_SWISS for an open-addressed table
+ *     probed 16 control bytes at a time.  HT_MAPPED tables are made by
+ *     ht_open_mapped() only.
+ */
+struct ht* ht_create_type(enum ht_type type){
     struct ht* ht = malloc(sizeof(struct ht));
-    ht->buckets = dynarray_create();
-    ht->num_buckets = cap(ht->buckets);
-    // initialize new hash table with empty list 
-    for (int i = 0; i < ht->num_buckets; i++) {
-        struct list* bucket = list_create();
-        dynarray_insert(ht->buckets, bucket);
-    }
+    ht->type = type;
+    ht->key_cmp = NULL;
+    ht->nodes = NULL;
+    ht->workers = NULL;
+    ht->rh = NULL;
+    ht->sw = NULL;
+    ht->snap = NULL;
+    ht->stats = NULL;
+    ht->filter = NULL;
+    ht->filter_cap = 0;
+    ht->filter_keys = 0;
+    ht->filter_load = 0;
+    ht->next_filter = NULL;
+    ht->next_idx = 0;
+    ht->buckets = NULL;
+    ht->num_buckets = 0;
+    ht->min_buckets = HT_MIN_BUCKETS;
+    ht->old_buckets = NULL;
+    ht->old_num_buckets = 0;
+    ht->rehash_idx = 0;
+    ht->size = 0;
+    ht->seed = random_seed(ht);
+    // the engine is only set up once the inline entries run out, the
+    // snapshot of a mapped table is attached by ht_open_mapped
+    ht->small = type != HT_MAPPED;
+    memset(ht->small_hashes, 0, sizeof(ht->small_hashes));
     return ht;
 }
 
+/*
+ * This function allocates and initializes an empty chained hash table with
+ * room for `n` elements, so bulk loading `n` elements never resizes it.  See
+ * ht_reserve().
+ *
+ * Params:
+ *   n - the number of elements to make room for.
+ */
+struct ht* ht_create_with_capacity(int n){
+    struct ht* ht = ht_create_type(HT_CHAINING);
+    ht_reserve(ht, n);
+    return ht;
+}
+
+/*
+ * This function makes sure a hash table can hold `n` elements without
+ * resizing.  Tables shrink by themselves as elements are removed, but never
+ * below the size reserved here.
+ *
+ * Params:
+ *   ht - the hash table to size.  May not be NULL or a mapped table.
+ *   n - the number of elements to make room for.
+ */
+void ht_reserve(struct ht* ht, int n){
+    assert(ht && ht->type != HT_MAPPED && n >= 0);
+    if (ht->small){
+        if (n <= HT_SMALL_MAX){
+            return;
+        }
+        leave_small(ht);
+    }
+    switch (ht->type){
+    case HT_ROBIN_HOOD:
+        if (ht->stats) stats_begin(ht);
+        rh_reserve(ht->rh, n);
+        if (ht->stats) stats_end(ht);
+        return;
+    case HT_SWISS:
+        if (ht->stats) stats_begin(ht);
+        sw_reserve(ht->sw, n);
+        if (ht->stats) stats_end(ht);
+        return;
+    default:
+        break;
+    }
+    // inserts resize once there are 4 elements per bucket
+    int nb = HT_MIN_BUCKETS;
+    while (4 * nb <= n){
+        nb *= 2;
+    }
+    ht->min_buckets = nb;
+    if (nb > ht->num_buckets){
+        rebucket(ht, nb);
+        rehash_step(ht, ht->old_num_buckets);
+    }
+}
+
+/*
+ * This function sets the seed of a hash table.  Every table starts with a
+ * random seed, so the buckets keys end up in differ from table to table and
+ * from run to run.  Fixing the seed makes the layout reproducible.  The seed
+ * can only be changed while the table is empty.
+ *
+ * Params:
+ *   ht - the hash table to configure.  May not be NULL or a mapped table.
+ *   seed - the new seed.
+ */
+void ht_set_seed(struct ht* ht, unsigned int seed){
+    assert(ht && ht->type != HT_MAPPED && ht_size(ht) == 0);
+    ht->seed = seed;
+}
+
+/*
+ * This function returns the number of buckets of a chained hash table or
+ * the number of slots of an open-addressed one.  A table that still keeps
+ * its entries inline has room for HT_SMALL_MAX of them.
+ *
+ * Params:
+ *   ht - the hash table.  May not be NULL.
+ */
+int ht_capacity(struct ht* ht){
+    assert(ht);
+    if (ht->small){
+        return HT_SMALL_MAX;
+    }
+    switch (ht->type){
+    case HT_ROBIN_HOOD:
+        return rh_capacity(ht->rh);
+    case HT_SWISS:
+        return sw_capacity(ht->sw);
+    case HT_MAPPED:
+        return snap_num_buckets(ht->snap);
+    default:
+        break;
+    }
+    return ht->num_buckets;
+}
+
+/*
+ * This function makes a chained hash table move its entries on several
+ * threads when it resizes.  By default a resize only sets up the new
+ * buckets and every later insert, lookup and remove moves a few old
+ * buckets, so no single call stalls for long.  With resize threads the
+ * resize moves every entry before it returns, with the old buckets split
+ * into ranges between `threads` threads: the calling thread plus a pool of
+ * `threads` - 1 worker threads kept for the life of the table.  Each thread
+ * writes its own set of new buckets, so the threads never lock.  This suits
+ * very large tables, whose resizes take long enough to be worth spreading
+ * over cores.  Old bucket arrays below HT_PARALLEL_MIN_BUCKETS are moved by
+ * the calling thread alone.  Robin Hood and Swiss tables always resize on
+ * one thread and ignore this setting.
+ *
+ * Params:
+ *   ht - the hash table to configure.  May not be NULL.
+ *   threads - the number of threads moving entries, or 0 to go back to
+ *     incremental resizing.
+ */
+void ht_set_resize_threads(struct ht* ht, int threads){
+    assert(ht && threads >= 0);
+    if (ht->workers){
+        wp_free(ht->workers);
+        ht->workers = NULL;
+    }
+    if (threads > 0 && ht->type == HT_CHAINING){
+        ht->workers = wp_create(threads);
+        if (!ht->small){
+            migrate_all(ht);
+        }
+    }
+}
+
+/*
+ * This function sets the function used to tell two keys apart.  Every entry
+ * keeps its key and the full hash code `convert` returned for it, so probes
+ * first skip entries whose hash code differs and only call `cmp` when the
+ * hash codes are equal.  Without a `cmp` function (the default) keys with
+ * the same hash code are considered the same key.
+ *
+ * Params:
+ *   ht - the hash table to configure.  May not be NULL.
+ *   cmp - pointer to a function that can be passed two keys to compare them
+ *     for equality.  It should return 0 if the two keys are equal and a
+ *     non-zero value otherwise.  May be NULL.
+ */
+void ht_set_key_cmp(struct ht* ht, int (*cmp)(void* a, void* b)){
+    assert(ht);
+    ht->key_cmp = cmp;
+}
+
 /*
  * This function should free the memory allocated to a given hash table.
  * Note that this function SHOULD NOT free the individual elements stored in
@@ -102,14 +769,45 @@ struct ht* ht_create(){
  */
 void ht_free(struct ht* ht){
     assert(ht);
+    free(ht->stats);
+    if (ht->filter){
+        bloom_free(ht->filter);
+    }
+    if (ht->next_filter){
+        bloom_free(ht->next_filter);
+    }
+    if (ht->workers){
+        wp_free(ht->workers);
+    }
+    if (ht->small){
+        free(ht);
+        return;
+    }
+    switch (ht->type){
+    case HT_ROBIN_HOOD:
+        rh_free(ht->rh);
+        free(ht);
+        return;
+    case HT_SWISS:
+        sw_free(ht->sw);
+        free(ht);
+        return;
+    case HT_MAPPED:
+        snap_close(ht->snap);
+        free(ht);
+        return;
+    default:
+        break;
+    }
     assert(ht->buckets);
-    // free all lists at all indexes of dynamic array 
-    for(int i = 0; i < ht->num_buckets; i++){ 
-        struct list* curr = dynarray_get(ht->buckets, i);
-        list_free(curr);
+    // free the bucket arrays, including the one of an unfinished resize,
+    // the nodes go with the slabs of the node pool below
+    list_array_free(ht->buckets, ht->num_buckets, ht->nodes);
+    if (ht->old_buckets){
+        list_array_free(ht->old_buckets, ht->old_num_buckets, ht->nodes);
     }
     // free rest 
-    dynarray_free(ht->buckets);
+    pool_free(ht->nodes);
     free(ht);
     return;
 }
@@ -144,15 +842,21 @@ int ht_isempty(struct ht* ht){
  */
 int ht_size(struct ht* ht){
     assert(ht);
-    assert(ht->buckets);
-
-    int size = 0;
-    //adds all elements(all nodes) at each index of dynarray
-    for (int i = 0; i < ht->num_buckets; i++){
-        struct list* bucket = dynarray_get(ht->buckets,i);
-        size += list_size(bucket);
+    if (ht->small){
+        return ht->size;
+    }
+    switch (ht->type){
+    case HT_ROBIN_HOOD:
+        return rh_size(ht->rh);
+    case HT_SWISS:
+        return sw_size(ht->sw);
+    case HT_MAPPED:
+        return snap_size(ht->snap);
+    default:
+        break;
     }
-    return size;
+    // the element count is kept up to date by insert and remove
+    return ht->size;
 }
 
 
@@ -173,8 +877,22 @@ int ht_size(struct ht* ht){
 int ht_hash_func(struct ht* ht, void* key, int (*convert)(void*)){
     assert(ht);
 
-    int hash_code = convert(key);
-    return (hash_code % ht->num_buckets); 
+    unsigned int hash_code = key_hash(ht, key, convert);
+    // the inline entries of a small table form a single bucket
+    if (ht->small){
+        return 0;
+    }
+    switch (ht->type){
+    case HT_ROBIN_HOOD:
+        return rh_home(ht->rh, hash_code);
+    case HT_SWISS:
+        return sw_home(ht->sw, hash_code);
+    case HT_MAPPED:
+        return snap_home(ht->snap, hash_code);
+    default:
+        break;
+    }
+    return bucket_index(hash_code, ht->num_buckets); 
 }
 
 
@@ -199,24 +917,204 @@ int ht_hash_func(struct ht* ht, void* key, int (*convert)(void*)){
 
 void ht_insert(struct ht* ht, void* key, void* value, int (*convert)(void*)){
     assert(ht);
+    // the user hash function runs once, entries cache its result
+    insert_hashed(ht, key, value, key_hash(ht, key, convert));
+}
+
+/*
+ * Function Name: insert_hashed
+ * Description: This function does the work of ht_insert once the hash code
+ *              of the key is known, a new key is also added to the Bloom
+ *              filter if the table has one
+ * Params:
+ *      ht - the hash table into which to insert an element
+ *      key - the key of the element
+ *      value - the value to be inserted
+ *      hash - the hash code of the key, see key_hash
+ * */
+void insert_hashed(struct ht* ht, void* key, void* value, unsigned int hash){
+    if (ht->filter == NULL){
+        store_hashed(ht, key, value, hash);
+        return;
+    }
+    int before = ht_size(ht);
+    store_hashed(ht, key, value, hash);
+    if (ht_size(ht) > before){
+        filter_add(ht, hash);
+    }
+    filter_update(ht);
+}
+
+/*
+ * Function Name: store_hashed
+ * Description: This function stores a key whose hash code is known in the
+ *              storage engine of a table
+ * Params:
+ *      ht - the hash table into which to insert an element
+ *      key - the key of the element
+ *      value - the value to be inserted
+ *      hash - the hash code of the key, see key_hash
+ * */
+void store_hashed(struct ht* ht, void* key, void* value, unsigned int hash){
+    if (ht->small){
+        int idx = small_find(ht, key, hash);
+        if (idx < 0 && ht->size < HT_SMALL_MAX){
+            idx = small_append(ht, key, hash);
+        }
+        if (idx >= 0){
+            ht->small_values[idx] = value;
+            return;
+        }
+        leave_small(ht);
+    }
+    switch (ht->type){
+    case HT_ROBIN_HOOD:
+        if (ht->stats) stats_begin(ht);
+        rh_insert(ht->rh, key, value, hash, ht->key_cmp);
+        if (ht->stats) stats_end(ht);
+        return;
+    case HT_SWISS:
+        if (ht->stats) stats_begin(ht);
+        sw_insert(ht->sw, key, value, hash, ht->key_cmp);
+        if (ht->stats) stats_end(ht);
+        return;
+    case HT_MAPPED:
+        // snapshots are read-only
+        assert(ht->type != HT_MAPPED);
+        return;
+    default:
+        break;
+    }
+    rehash_step(ht, HT_REHASH_STEP);
+    // during a resize the key may still sit in its old bucket, move that
+    // bucket over first so the key can only be found in the new buckets
+    if (ht->old_buckets){
+        migrate_bucket(ht, bucket_index(hash, ht->old_num_buckets));
+    }
     // idx of key 
-    int idx = ht_hash_func(ht, key, convert);
+    int idx = bucket_index(hash, ht->num_buckets);
     // get the list at the index of the key
-    struct list* bucket = dynarray_get(ht->buckets, idx);
-    // inserts the value  
-    list_insert_key(bucket, value, key, convert);
-    // gets the load factor 
-    int num_elem = ht_size(ht);
-    float load_factor = num_elem/ht->num_buckets;
+    struct list* bucket = list_array_get(ht->buckets, idx);
+    // inserts the value, only a new key changes the size
+    ht->size += list_insert_key(bucket, key, value, hash, ht->key_cmp, ht->nodes);
     // checks if the load factor is greater than 4
     // if so then a resize is in order
-    if(load_factor >= 4.0){
-        resize(ht, convert);
+    if(ht->size >= 4 * ht->num_buckets){
+        resize(ht, NULL);
     }
     return;
 }
 
 
+/*
+ * This function adds to the value stored under a key in place, the way a
+ * group-by aggregation does: if the key is new its value is `init(key, arg)`,
+ * otherwise the value becomes `update(value, arg)`.  The table is probed
+ * once, where ht_lookup() followed by ht_insert() would probe it twice.
+ * A new key is stored as it is passed, so it must stay valid as long as the
+ * entry is in the table.
+ *
+ * Params:
+ *   ht - the hash table to update.  May not be NULL.
+ *   key - the key of the element
+ *   convert - pointer to a function that can be passed the void* key from
+ *     to convert it to a unique integer hashcode
+ *   init - returns the first value of a key that is not in the table yet.
+ *   update - returns the new value of a key, given its current value.  It
+ *     may change the value it points to and return it again.
+ *   arg - passed through to `init` and `update`, e.g. the row being added.
+ *
+ * Return:
+ *   This function returns the value now stored under `key`.
+ */
+void* ht_upsert(struct ht* ht, void* key, int (*convert)(void*), void* (*init)(void* key, void* arg),
+        void* (*update)(void* value, void* arg), void* arg){
+    assert(ht && init && update);
+    return upsert_hashed(ht, key, key_hash(ht, key, convert), init, update, arg);
+}
+
+/*
+ * Function Name: upsert_hashed
+ * Description: This function does the work of ht_upsert once the hash code
+ *              of the key is known.  The storage engine returns where the
+ *              value of the key is stored, so it is updated without a
+ *              second probe
+ * Params:
+ *      ht - the hash table to update
+ *      key - the key of the element
+ *      hash - the hash code of the key, see key_hash
+ *      init, update, arg - see ht_upsert
+ * Return:
+ *      the value now stored under the key
+ * */
+void* upsert_hashed(struct ht* ht, void* key, unsigned int hash, void* (*init)(void* key, void* arg),
+        void* (*update)(void* value, void* arg), void* arg){
+    int created;
+    void** slot = NULL;
+
+    if (ht->small){
+        slot = small_upsert(ht, key, hash, &created);
+    }
+    if (slot == NULL){
+        slot = engine_upsert(ht, key, hash, &created);
+    }
+    // the slot is written before a resize can move the entry
+    void* value = created ? init(key, arg) : update(*slot, arg);
+    *slot = value;
+
+    if (ht->type == HT_CHAINING && !ht->small && ht->size >= 4 * ht->num_buckets){
+        resize(ht, NULL);
+    }
+    if (created && ht->filter){
+        filter_add(ht, hash);
+        filter_update(ht);
+    }
+    return value;
+}
+
+/*
+ * Function Name: engine_upsert
+ * Description: This function finds or adds the entry of a key in the
+ *              storage engine of a table and returns where its value is
+ *              stored, see rh_upsert
+ * Params:
+ *      ht - the hash table to update, it may not be small
+ *      key - the key of the element
+ *      hash - the hash code of the key, see key_hash
+ *      created - set to 1 if the entry was added and to 0 if it existed
+ * */
+void** engine_upsert(struct ht* ht, void* key, unsigned int hash, int* created){
+    void** slot;
+
+    switch (ht->type){
+    case HT_ROBIN_HOOD:
+        if (ht->stats) stats_begin(ht);
+        slot = rh_upsert(ht->rh, key, hash, ht->key_cmp, created);
+        if (ht->stats) stats_end(ht);
+        return slot;
+    case HT_SWISS:
+        if (ht->stats) stats_begin(ht);
+        slot = sw_upsert(ht->sw, key, hash, ht->key_cmp, created);
+        if (ht->stats) stats_end(ht);
+        return slot;
+    case HT_MAPPED:
+        // snapshots are read-only
+        assert(ht->type != HT_MAPPED);
+        return NULL;
+    default:
+        break;
+    }
+    rehash_step(ht, HT_REHASH_STEP);
+    if (ht->old_buckets){
+        migrate_bucket(ht, bucket_index(hash, ht->old_num_buckets));
+    }
+    slot = list_upsert(list_array_get(ht->buckets, bucket_index(hash, ht->num_buckets)),
+        key, hash, ht->key_cmp, ht->nodes, created);
+    ht->size += *created;
+    return slot;
+}
+
+
 /*
  * This function should search for a given element in a hash table with a
  * specified key provided.   
@@ -235,18 +1133,72 @@ void ht_insert(struct ht* ht, void* key, void* value, int (*convert)(void*)){
  *   Should return the value of the corresponding 'key' in the hash table .
  */
 void* ht_lookup(struct ht* ht, void* key, int (*convert)(void*)){
-    
-    int idx = ht_hash_func(ht, key, convert);
-    struct list* bucket = dynarray_get(ht->buckets, idx);
-    
-    struct node* curr = head_get(bucket);
-    // if the element of the current nodes hash code matches the keys
-    // hash code it will return the node
-    while(curr){
-        if (convert(node_val(curr)) == convert(key)){
-            return node_val(curr);
+    assert(ht);
+    return lookup_hashed(ht, key, key_hash(ht, key, convert));
+}
+
+/*
+ * Function Name: lookup_hashed
+ * Description: This function does the work of ht_lookup once the hash code
+ *              of the key is known
+ * Params:
+ *      ht - the hash table to search
+ *      key - the key of the element to search for
+ *      hash - the hash code of the key, see key_hash
+ * */
+void* lookup_hashed(struct ht* ht, void* key, unsigned int hash){
+    // a key the filter has never seen is not in the table
+    void* value = NULL;
+    if (ht->filter == NULL || bloom_may_contain(ht->filter, hash)){
+        value = find_hashed(ht, key, hash);
+    }
+    if (ht->stats){
+        count_lookup(ht, key, hash, value != NULL);
+    }
+    return value;
+}
+
+/*
+ * Function Name: find_hashed
+ * Description: This function searches the storage engine of a table for a
+ *              key whose hash code is known and returns its value, or NULL
+ * Params:
+ *      ht - the hash table to search
+ *      key - the key of the element to search for
+ *      hash - the hash code of the key, see key_hash
+ * */
+void* find_hashed(struct ht* ht, void* key, unsigned int hash){
+    if (ht->small){
+        int idx = small_find(ht, key, hash);
+        return idx >= 0 ? ht->small_values[idx] : NULL;
+    }
+    switch (ht->type){
+    case HT_ROBIN_HOOD:
+        return rh_lookup(ht->rh, key, hash, ht->key_cmp);
+    case HT_SWISS:
+        return sw_lookup(ht->sw, key, hash, ht->key_cmp);
+    case HT_MAPPED:
+        return snap_lookup(ht->snap, hash);
+    default:
+        break;
+    }
+    rehash_step(ht, HT_REHASH_STEP);
+
+    int idx = bucket_index(hash, ht->num_buckets);
+    struct list* bucket = list_array_get(ht->buckets, idx);
+    // while a resize is in progress the key is either in its new bucket
+    // or in its old bucket, if that one has not been migrated yet
+    struct list* old_bucket = old_bucket_get(ht, hash);
+    
+    while(bucket){
+        // nodes are rejected on their cached hash code, the key compare
+        // function only runs when the hash codes match
+        struct node* curr = list_find(bucket, key, hash, ht->key_cmp);
+        if (curr){
+            return node_val(curr);
         }
-        curr = next_node(curr);
+        bucket = old_bucket;
+        old_bucket = NULL;
     }
     // if the element is not found, NULL is returned 
     return NULL;
@@ -268,12 +1220,927 @@ void* ht_lookup(struct ht* ht, void* key, int (*convert)(void*)){
  */
 void ht_remove(struct ht* ht, void* key, int (*convert)(void*)){
     assert(ht);
+    remove_hashed(ht, key, key_hash(ht, key, convert));
+    // the filter keeps the bits of the key, they only cost false positives
+    // until the next rebuild
+    if (ht->filter){
+        filter_update(ht);
+    }
+}
+
+/*
+ * Function Name: remove_hashed
+ * Description: This function removes a key whose hash code is known from the
+ *              storage engine of a table
+ * Params:
+ *      ht - the hash table from which to remove an element
+ *      key - the key of the element to remove
+ *      hash - the hash code of the key, see key_hash
+ * */
+void remove_hashed(struct ht* ht, void* key, unsigned int hash){
+    if (ht->small){
+        int idx = small_find(ht, key, hash);
+        if (idx >= 0){
+            // the last entry fills the hole, inline entries have no order
+            ht->size--;
+            ht->small_hashes[idx] = ht->small_hashes[ht->size];
+            ht->small_keys[idx] = ht->small_keys[ht->size];
+            ht->small_values[idx] = ht->small_values[ht->size];
+        }
+        return;
+    }
+    switch (ht->type){
+    case HT_ROBIN_HOOD:
+        if (ht->stats) stats_begin(ht);
+        rh_remove(ht->rh, key, hash, ht->key_cmp);
+        if (ht->stats) stats_end(ht);
+        return;
+    case HT_SWISS:
+        if (ht->stats) stats_begin(ht);
+        sw_remove(ht->sw, key, hash, ht->key_cmp);
+        if (ht->stats) stats_end(ht);
+        return;
+    case HT_MAPPED:
+        // snapshots are read-only
+        assert(ht->type != HT_MAPPED);
+        return;
+    default:
+        break;
+    }
+    rehash_step(ht, HT_REHASH_STEP);
+    if (ht->old_buckets){
+        migrate_bucket(ht, bucket_index(hash, ht->old_num_buckets));
+    }
     
-    int idx = ht_hash_func(ht, key, convert);
+    int idx = bucket_index(hash, ht->num_buckets);
     // gets the list at the index returned from the hash function
-    // and removes the node that matches the hashcode
-    struct list *bucket = dynarray_get(ht->buckets,idx);
-    return list_remove(bucket, key, convert);
+    // and removes the node that matches the key
+    struct list *bucket = list_array_get(ht->buckets, idx);
+    ht->size -= list_remove(bucket, key, hash, ht->key_cmp, ht->nodes);
+    // halve the buckets once there is less than one element for every two
+    // buckets, so memory is handed back after a purge
+    if (ht->size * 2 < ht->num_buckets && ht->num_buckets > ht->min_buckets){
+        rebucket(ht, ht->num_buckets / 2);
+    }
+
+}
+
+
+/*====================================================================================================*/
+
+/*
+ * Number of keys of a batch that are hashed and prefetched together before
+ * any of them is resolved.
+ */
+#define HT_BATCH_CHUNK 32
+
+/*
+ * Function Name: prefetch_hashes
+ * Description: This function prefetches the memory the first probe of each
+ *              hash code of a chunk will touch.  For chained tables the
+ *              bucket pointers and then the first chain nodes are loaded for
+ *              the whole chunk, so those cache misses overlap instead of
+ *              being paid one key after the other
+ * Params:
+ *      ht - the hash table the keys will be looked up or inserted in
+ *      hashes - the hash codes of the chunk, see key_hash
+ *      n - number of hash codes in the chunk, at most HT_BATCH_CHUNK
+ * */
+void prefetch_hashes(struct ht* ht, unsigned int* hashes, int n){
+    struct list* buckets[HT_BATCH_CHUNK];
+
+    for (int i = 0; i < n; i++){
+        // inline entries live in the ht structure, which is in cache already
+        if (ht->small){
+            continue;
+        }
+        switch (ht->type){
+        case HT_ROBIN_HOOD:
+            rh_prefetch(ht->rh, hashes[i]);
+            break;
+        case HT_SWISS:
+            sw_prefetch(ht->sw, hashes[i]);
+            break;
+        case HT_MAPPED:
+            snap_prefetch(ht->snap, hashes[i]);
+            break;
+        default:
+            buckets[i] = list_array_get(ht->buckets, bucket_index(hashes[i], ht->num_buckets));
+            __builtin_prefetch(buckets[i]);
+            break;
+        }
+        if (ht->filter){
+            bloom_prefetch(ht->filter, hashes[i]);
+        }
+    }
+    if (ht->type == HT_CHAINING && !ht->small){
+        for (int i = 0; i < n; i++){
+            __builtin_prefetch(head_get(buckets[i]));
+        }
+    }
+}
+
+/*
+ * Function Name: prefetch_chunk
+ * Description: This function hashes a chunk of keys and prefetches the memory
+ *              the first probe of each key will touch, see prefetch_hashes
+ * Params:
+ *      ht - the hash table the keys will be looked up or inserted in
+ *      keys - the keys of the chunk
+ *      n - number of keys in the chunk, at most HT_BATCH_CHUNK
+ *      convert - converts a key to its hash code
+ *      hashes - receives the hash code of every key
+ * */
+void prefetch_chunk(struct ht* ht, void** keys, int n, int (*convert)(void*), unsigned int* hashes){
+    for (int i = 0; i < n; i++){
+        hashes[i] = key_hash(ht, keys[i], convert);
+    }
+    prefetch_hashes(ht, hashes, n);
+}
+
+/*
+ * This function looks up a whole batch of keys.  Keys are handled in chunks:
+ * every key of a chunk is hashed and the memory its probe starts at is
+ * prefetched, then the chunk is resolved in a second pass.  The memory
+ * latency of the keys of one chunk is paid once instead of once per key.
+ *
+ * Params:
+ *   ht - the hash table to search.  May not be NULL.
+ *   keys - array of `n` keys to search for.
+ *   n - the number of keys.
+ *   convert - pointer to a function that can be passed the void* key from
+ *     to convert it to a unique integer hashcode
+ *   out - array of at least `n` elements.  out[i] receives the value stored
+ *     under keys[i], or NULL if that key is not in the table.
+ */
+void ht_lookup_batch(struct ht* ht, void** keys, int n, int (*convert)(void*), void** out){
+    assert(ht);
+    unsigned int hashes[HT_BATCH_CHUNK];
+
+    for (int start = 0; start < n; start += HT_BATCH_CHUNK){
+        int len = n - start < HT_BATCH_CHUNK ? n - start : HT_BATCH_CHUNK;
+        prefetch_chunk(ht, keys + start, len, convert, hashes);
+        for (int i = 0; i < len; i++){
+            out[start + i] = lookup_hashed(ht, keys[start + i], hashes[i]);
+        }
+    }
+}
+
+/*
+ * This function inserts a whole batch of key/value pairs, hashing and
+ * prefetching a chunk of keys before inserting them like ht_lookup_batch.
+ * Pairs are inserted in order, so when a key appears twice the later value
+ * wins.
+ *
+ * Params:
+ *   ht - the hash table into which to insert.  May not be NULL.
+ *   keys - array of `n` keys.
+ *   values - array of `n` values, values[i] is stored under keys[i].
+ *   n - the number of pairs.
+ *   convert - pointer to a function that can be passed the void* key from
+ *     to convert it to a unique integer hashcode
+ */
+void ht_insert_batch(struct ht* ht, void** keys, void** values, int n, int (*convert)(void*)){
+    assert(ht);
+    unsigned int hashes[HT_BATCH_CHUNK];
+
+    for (int start = 0; start < n; start += HT_BATCH_CHUNK){
+        int len = n - start < HT_BATCH_CHUNK ? n - start : HT_BATCH_CHUNK;
+        prefetch_chunk(ht, keys + start, len, convert, hashes);
+        for (int i = 0; i < len; i++){
+            insert_hashed(ht, keys[start + i], values[start + i], hashes[i]);
+        }
+    }
+}
+
+
+/*
+ * This function runs ht_upsert() for a whole batch of keys, hashing and
+ * prefetching a chunk of keys before updating them like ht_lookup_batch.
+ * Keys are handled in order, so a key that appears twice is updated twice.
+ *
+ * Params:
+ *   ht - the hash table to update.  May not be NULL.
+ *   keys - array of `n` keys.
+ *   args - array of `n` arguments, args[i] is passed to `init` or `update`
+ *     for keys[i].  May be NULL, then `init` and `update` receive NULL.
+ *   n - the number of keys.
+ *   convert - pointer to a function that can be passed the void* key from
+ *     to convert it to a unique integer hashcode
+ *   init, update - see ht_upsert().
+ */
+void ht_upsert_batch(struct ht* ht, void** keys, void** args, int n, int (*convert)(void*),
+        void* (*init)(void* key, void* arg), void* (*update)(void* value, void* arg)){
+    assert(ht && init && update);
+    unsigned int hashes[HT_BATCH_CHUNK];
+
+    for (int start = 0; start < n; start += HT_BATCH_CHUNK){
+        int len = n - start < HT_BATCH_CHUNK ? n - start : HT_BATCH_CHUNK;
+        prefetch_chunk(ht, keys + start, len, convert, hashes);
+        for (int i = 0; i < len; i++){
+            upsert_hashed(ht, keys[start + i], hashes[i], init, update,
+                args ? args[start + i] : NULL);
+        }
+    }
+}
+
+/*
+ * This function is ht_upsert_batch() for callers that already ran `convert`
+ * on every key, e.g. to partition the keys, so it is not called again.
+ *
+ * Params:
+ *   ht - the hash table to update.  May not be NULL.
+ *   keys - array of `n` keys.
+ *   codes - array of `n` hash codes, codes[i] must be what the `convert`
+ *     function later passed to ht_lookup() returns for keys[i].
+ *   args - array of `n` arguments, see ht_upsert_batch().  May be NULL.
+ *   n - the number of keys.
+ *   init, update - see ht_upsert().
+ */
+void ht_upsert_batch_codes(struct ht* ht, void** keys, int* codes, void** args, int n,
+        void* (*init)(void* key, void* arg), void* (*update)(void* value, void* arg)){
+    assert(ht && init && update);
+    unsigned int hashes[HT_BATCH_CHUNK];
+
+    for (int start = 0; start < n; start += HT_BATCH_CHUNK){
+        int len = n - start < HT_BATCH_CHUNK ? n - start : HT_BATCH_CHUNK;
+        for (int i = 0; i < len; i++){
+            hashes[i] = hash_mix32((unsigned int)codes[start + i] ^ ht->seed);
+        }
+        prefetch_hashes(ht, hashes, len);
+        for (int i = 0; i < len; i++){
+            upsert_hashed(ht, keys[start + i], hashes[i], init, update,
+                args ? args[start + i] : NULL);
+        }
+    }
+}
+
+
+/*====================================================================================================*/
+
+/*
+ * Function Name: for_each_entry
+ * Description: This function calls `fn` once for every entry of a hash
+ *              table, whatever its storage engine.  The table may not be
+ *              changed while it is being walked
+ * Params:
+ *      ht - the hash table to walk
+ *      fn - called with `arg` and the key, value and hash code of an entry
+ *      arg - passed through to `fn`
+ * */
+void for_each_entry(struct ht* ht, void (*fn)(void* arg, void* key, void* value, unsigned int hash),
+        void* arg){
+    void* key, * value;
+    unsigned int hash;
+
+    if (ht->small){
+        for (int i = 0; i < ht->size; i++){
+            fn(arg, ht->small_keys[i], ht->small_values[i], ht->small_hashes[i]);
+        }
+        return;
+    }
+    switch (ht->type){
+    case HT_ROBIN_HOOD:
+        for (int i = 0; i < rh_capacity(ht->rh); i++){
+            if (rh_slot_get(ht->rh, i, &key, &value, &hash)){
+                fn(arg, key, value, hash);
+            }
+        }
+        return;
+    case HT_SWISS:
+        for (int i = 0; i < sw_capacity(ht->sw); i++){
+            if (sw_slot_get(ht->sw, i, &key, &value, &hash)){
+                fn(arg, key, value, hash);
+            }
+        }
+        return;
+    case HT_MAPPED:
+        // a snapshot cannot be walked, it does not keep keys
+        assert(ht->type != HT_MAPPED);
+        return;
+    default:
+        break;
+    }
+    // walk the current buckets and then the old buckets not migrated yet
+    for (int i = 0; i < ht->num_buckets; i++){
+        for (void* curr = head_get(list_array_get(ht->buckets, i)); curr; curr = next_node(curr)){
+            fn(arg, node_key(curr), node_val(curr), node_hash(curr));
+        }
+    }
+    for (int i = ht->rehash_idx; ht->old_buckets && i < ht->old_num_buckets; i++){
+        for (void* curr = head_get(list_array_get(ht->old_buckets, i)); curr; curr = next_node(curr)){
+            fn(arg, node_key(curr), node_val(curr), node_hash(curr));
+        }
+    }
+}
+
+/*
+ * Number of empty scan steps ht_scan may take for every entry it was asked
+ * for before it returns, so a sparse table is not walked in a single call.
+ */
+#define HT_SCAN_EMPTY_STEPS 10
+
+/*
+ * This structure collects the entries of one ht_scan call.  `count` keeps
+ * counting past `room`, so ht_scan can tell how much room a step needed.
+ */
+struct scan_state{
+    struct ht_entry* out;
+    int count;
+    int room;
+};
+
+/*
+ * Function Name: scan_entry
+ * Description: This function appends one entry to a scan_state if there is
+ *              room for it, it is the callback of the engines' scan functions
+ * */
+void scan_entry(void* arg, void* key, void* value){
+    struct scan_state* state = arg;
+    if (state->count < state->room){
+        state->out[state->count].key = key;
+        state->out[state->count].value = value;
+    }
+    state->count++;
+}
+
+/*
+ * Function Name: reverse_bits
+ * Description: This function returns a 32-bit number with its bits in
+ *              reverse order
+ * */
+unsigned int reverse_bits(unsigned int v){
+    v = ((v >> 1) & 0x55555555u) | ((v & 0x55555555u) << 1);
+    v = ((v >> 2) & 0x33333333u) | ((v & 0x33333333u) << 2);
+    v = ((v >> 4) & 0x0f0f0f0fu) | ((v & 0x0f0f0f0fu) << 4);
+    v = ((v >> 8) & 0x00ff00ffu) | ((v & 0x00ff00ffu) << 8);
+    return (v >> 16) | (v << 16);
+}
+
+/*
+ * Function Name: next_cursor
+ * Description: This function advances a scan cursor past the scan bucket
+ *              `cursor & mask` by incrementing its masked bits from the most
+ *              significant one down
+ * */
+unsigned int next_cursor(unsigned int cursor, unsigned int mask){
+    cursor |= ~mask;
+    return reverse_bits(reverse_bits(cursor) + 1);
+}
+
+/*
+ * Function Name: scan_bucket
+ * Description: This function visits every entry of one scan bucket of a
+ *              table.  Scan buckets are numbered so that, like the buckets
+ *              of a chained table, the low bits of a hash code pick its
+ *              bucket: a chained bucket is one bucket, a Swiss table group is
+ *              the entries whose probe starts there, and Robin Hood homes,
+ *              which are picked by the high bits of a hash code, are
+ *              numbered in bit reversed order
+ * Params:
+ *      ht - the hash table being scanned
+ *      buckets - for chained tables, the bucket array to read
+ *      b - the index of the scan bucket
+ *      state - receives the entries
+ * */
+void scan_bucket(struct ht* ht, struct list* buckets, unsigned int b, struct scan_state* state){
+    switch (ht->type){
+    case HT_ROBIN_HOOD:
+        rh_scan_home(ht->rh, (int)(reverse_bits(b) >> (32 - __builtin_ctz(rh_capacity(ht->rh)))),
+            scan_entry, state);
+        return;
+    case HT_SWISS:
+        sw_scan_group(ht->sw, (int)b, scan_entry, state);
+        return;
+    default:
+        break;
+    }
+    for (void* curr = head_get(list_array_get(buckets, (int)b)); curr; curr = next_node(curr)){
+        scan_entry(state, node_key(curr), node_val(curr));
+    }
+}
 
+/*
+ * Function Name: scan_step
+ * Description: This function visits the entries under one cursor value and
+ *              returns the next cursor.  While a chained table is resizing,
+ *              its entries are split between two bucket arrays.  The scan
+ *              bucket of the smaller array is visited together with every
+ *              bucket of the larger array it splits into, so the cursor keeps
+ *              advancing by the smaller array's bucket count
+ * Params:
+ *      ht - the hash table being scanned
+ *      cursor - the cursor value to visit
+ *      state - receives the entries
+ * */
+unsigned int scan_step(struct ht* ht, unsigned int cursor, struct scan_state* state){
+    // the inline entries are a single bucket, a table never goes back to
+    // being small so a scan that sees one is done after it
+    if (ht->small){
+        for (int i = 0; i < ht->size; i++){
+            scan_entry(state, ht->small_keys[i], ht->small_values[i]);
+        }
+        return 0;
+    }
+    switch (ht->type){
+    case HT_ROBIN_HOOD:
+        scan_bucket(ht, NULL, cursor & (rh_capacity(ht->rh) - 1), state);
+        return next_cursor(cursor, rh_capacity(ht->rh) - 1);
+    case HT_SWISS:
+        scan_bucket(ht, NULL, cursor & (sw_num_groups(ht->sw) - 1), state);
+        return next_cursor(cursor, sw_num_groups(ht->sw) - 1);
+    default:
+        break;
+    }
+    if (ht->old_buckets == NULL){
+        scan_bucket(ht, ht->buckets, cursor & (ht->num_buckets - 1), state);
+        return next_cursor(cursor, ht->num_buckets - 1);
+    }
+    struct list* small = ht->buckets, * large = ht->old_buckets;
+    unsigned int small_mask = ht->num_buckets - 1, large_mask = ht->old_num_buckets - 1;
+    if (small_mask > large_mask){
+        small = ht->old_buckets;
+        large = ht->buckets;
+        small_mask = ht->old_num_buckets - 1;
+        large_mask = ht->num_buckets - 1;
+    }
+    scan_bucket(ht, small, cursor & small_mask, state);
+    do {
+        scan_bucket(ht, large, cursor & large_mask, state);
+        cursor = next_cursor(cursor, large_mask);
+    } while (cursor & (small_mask ^ large_mask));
+    return cursor;
+}
+
+/*
+ * This function returns the next batch of entries of a scan over a hash
+ * table.  A scan starts with a cursor of 0 and is over once ht_scan() sets
+ * the cursor back to 0.  Between calls the table may be changed freely:
+ * every entry that is in the table for the whole scan is returned at least
+ * once, even if the table resizes in between.  Entries inserted or removed
+ * during the scan may or may not be returned, and an entry may be returned
+ * more than once if the table shrank.  Cursors visit scan buckets in bit
+ * reversed order, so the buckets a cursor has passed are still passed after
+ * the bucket count doubles or halves.
+ *
+ * Entries of one scan bucket are always returned by the same call.  A call
+ * may return fewer than `batch` entries, even 0, before the scan is over.
+ *
+ * Params:
+ *   ht - the hash table to scan.  May not be NULL or a mapped table.
+ *   cursor - the position of the scan, 0 to start.  Receives the position
+ *     the next call continues from.
+ *   batch - the number of entries `out` has room for.
+ *   out - receives the entries.
+ *
+ * Return:
+ *   Returns the number of entries written to `out`.  If the next scan
+ *   bucket alone holds more than `batch` entries, returns minus the number
+ *   of entries it holds and leaves the cursor alone, so the call can be
+ *   repeated with a larger `out`.
+ */
+int ht_scan(struct ht* ht, unsigned int* cursor, int batch, struct ht_entry* out){
+    assert(ht && ht->type != HT_MAPPED && cursor && batch > 0 && out);
+    struct scan_state state = { out, 0, batch };
+    unsigned int v = *cursor;
+    long steps = (long)batch * HT_SCAN_EMPTY_STEPS;
+
+    do {
+        int before = state.count;
+        unsigned int next = scan_step(ht, v, &state);
+        if (state.count > batch){
+            // the step did not fit, it is left for the next call
+            *cursor = v;
+            return before > 0 ? before : -state.count;
+        }
+        v = next;
+    } while (v != 0 && state.count < batch && --steps > 0);
+    *cursor = v;
+    return state.count;
+}
+
+/*
+ * This structure collects the hash codes and values of a table for ht_save.
+ */
+struct save_state{
+    unsigned int* hashes;
+    void** values;
+    int count;
+};
+
+/*
+ * Function Name: collect_entry
+ * Description: This function appends one entry to a save_state, it is the
+ *              for_each_entry callback of ht_save
+ * */
+void collect_entry(void* arg, void* key, void* value, unsigned int hash){
+    struct save_state* state = arg;
+    state->hashes[state->count] = hash;
+    state->values[state->count] = value;
+    state->count++;
+}
+
+/*
+ * This function writes the contents of a hash table to a snapshot file that
+ * ht_open_mapped() can later map straight into memory.  The file holds no
+ * pointers: for every entry it keeps the hash code the table stored for its
+ * key and a copy of the `value_size` bytes its value points to.  Keys
+ * themselves are not saved, so the snapshot tells keys apart by their hash
+ * codes alone, like a table without a key compare function.
+ *
+ * Params:
+ *   ht - the hash table to save.  May not be NULL or a mapped table.
+ *   path - the file to write.  An existing file is replaced.
+ *   value_size - the number of bytes every value points to.
+ *
+ * Return:
+ *   Returns 0 if the snapshot was written and -1 otherwise.
+ */
+int ht_save(struct ht* ht, const char* path, size_t value_size){
+    assert(ht && ht->type != HT_MAPPED);
+    int n = ht_size(ht);
+    struct save_state state;
+
+    state.hashes = malloc((n > 0 ? n : 1) * sizeof(unsigned int));
+    state.values = malloc((n > 0 ? n : 1) * sizeof(void*));
+    state.count = 0;
+    assert(state.hashes && state.values);
+    for_each_entry(ht, collect_entry, &state);
+    assert(state.count == n);
+
+    int ret = snap_write(path, state.hashes, state.values, n, value_size, ht->seed);
+    free(state.hashes);
+    free(state.values);
+    return ret;
+}
 
-} 
+/*
+ * This function opens a snapshot written by ht_save() as a read-only hash
+ * table of type HT_MAPPED.  The file is mapped into memory and searched in
+ * place, so lookups need no deserialization.  Opening only scans the bucket
+ * offsets, 4 bytes per bucket, to check them (see snap_open()).  ht_lookup()
+ * and ht_lookup_batch() take the same `convert` function the saved table was
+ * filled with and return pointers to the saved value bytes inside the
+ * mapping.  ht_insert() and ht_remove() may not be called on the table.
+ * ht_free() unmaps it.
+ *
+ * Params:
+ *   path - the snapshot file to open.
+ *
+ * Return:
+ *   Returns the mapped hash table, or NULL if the file could not be opened
+ *   or is not a valid snapshot.
+ */
+struct ht* ht_open_mapped(const char* path){
+    struct snapshot* snap = snap_open(path);
+    if (snap == NULL){
+        return NULL;
+    }
+    struct ht* ht = ht_create_type(HT_MAPPED);
+    ht->snap = snap;
+    // keys must be hashed the way they were when the snapshot was saved
+    ht->seed = snap_seed(snap);
+    return ht;
+}
+
+
+/*====================================================================================================*/
+
+/*
+ * Function Name: probes_for
+ * Description: This function returns how many entries (slots for Robin
+ *              Hood tables, 16-slot groups for Swiss tables) a lookup of a
+ *              key looks at, whether or not the key is found
+ * Params:
+ *      ht - the hash table
+ *      key - the key
+ *      hash - the hash code of the key, see key_hash
+ * */
+int probes_for(struct ht* ht, void* key, unsigned int hash){
+    // all inline hash codes are compared at once
+    if (ht->small){
+        return 1;
+    }
+    switch (ht->type){
+    case HT_ROBIN_HOOD:
+        return rh_probes(ht->rh, key, hash, ht->key_cmp);
+    case HT_SWISS:
+        return sw_probes(ht->sw, key, hash, ht->key_cmp);
+    case HT_MAPPED:
+        return snap_probes(ht->snap, hash);
+    default:
+        break;
+    }
+    struct list* bucket = list_array_get(ht->buckets, bucket_index(hash, ht->num_buckets));
+    int probes = list_probes(bucket, key, hash, ht->key_cmp);
+    // the old bucket is only searched if the key is not in the new one
+    struct list* old_bucket = old_bucket_get(ht, hash);
+    if (old_bucket && list_find(bucket, key, hash, ht->key_cmp) == NULL){
+        probes += list_probes(old_bucket, key, hash, ht->key_cmp);
+    }
+    return probes;
+}
+
+/*
+ * Function Name: count_lookup
+ * Description: This function adds one lookup to the statistics of a table
+ * Params:
+ *      ht - hash table with statistics turned on
+ *      key - the key that was looked up
+ *      hash - the hash code of the key, see key_hash
+ *      hit - 1 if the key was found, 0 otherwise
+ * */
+void count_lookup(struct ht* ht, void* key, unsigned int hash, int hit){
+    struct ht_counters* c = ht->stats;
+    int probes = probes_for(ht, key, hash);
+    if (hit){
+        c->hits++;
+        c->hit_probes += probes;
+        if (probes > c->max_hit){
+            c->max_hit = probes;
+        }
+    } else {
+        c->misses++;
+        c->miss_probes += probes;
+        if (probes > c->max_miss){
+            c->max_miss = probes;
+        }
+    }
+}
+
+/*
+ * Function Name: add_to_bin
+ * Description: This function counts one value in the occupancy histogram,
+ *              values past the last bin are counted in the last bin
+ * */
+void add_to_bin(struct ht_stats* out, int value){
+    out->occupancy[value < HT_STATS_BINS ? value : HT_STATS_BINS - 1]++;
+}
+
+/*
+ * This function turns the collection of statistics on or off.  While it is
+ * off (the default) inserts, lookups and removes only pay for one branch on
+ * a NULL pointer.  While it is on, every lookup also counts how many entries
+ * it looked at, and every resize is timed.  Turning statistics on resets
+ * the counters.
+ *
+ * Params:
+ *   ht - the hash table to configure.  May not be NULL.
+ *   enable - 1 to turn statistics on, 0 to turn them off.
+ */
+void ht_enable_stats(struct ht* ht, int enable){
+    assert(ht);
+    free(ht->stats);
+    ht->stats = NULL;
+    if (enable){
+        ht->stats = calloc(1, sizeof(struct ht_counters));
+        assert(ht->stats);
+    }
+}
+
+/*
+ * This function reports statistics about a hash table.  The occupancy
+ * histogram is computed from the table as it is right now and is always
+ * filled in.  For chained and mapped tables occupancy[i] is the number of
+ * buckets holding i entries.  For Robin Hood and Swiss tables it is the
+ * number of entries a lookup reaches after i + 1 probes.  The last bin also
+ * counts everything past it.  Lookup and resize counters cover the time
+ * since statistics were turned on with ht_enable_stats() and are 0 if they
+ * are off.  A lookup probe is one list node or slot for chained, mapped and
+ * Robin Hood tables and one group of 16 slots for Swiss tables.  A table
+ * that still keeps its entries inline reports them as one bucket if it is
+ * chained, and as entries found after one probe otherwise.  max_filter_adds
+ * is the most entries a single call added to a rebuilt Bloom filter.
+ *
+ * Params:
+ *   ht - the hash table.  May not be NULL.
+ *   out - receives the statistics.  May not be NULL.
+ */
+void ht_stats(struct ht* ht, struct ht_stats* out){
+    assert(ht && out);
+    void* key, * value;
+    unsigned int hash;
+
+    memset(out, 0, sizeof(*out));
+    if (ht->small){
+        if (ht->type == HT_CHAINING){
+            add_to_bin(out, ht->size);
+        }else{
+            out->occupancy[0] = ht->size;
+        }
+    }
+    else switch (ht->type){
+    case HT_ROBIN_HOOD:
+        for (int i = 0; i < rh_capacity(ht->rh); i++){
+            if (rh_slot_get(ht->rh, i, &key, &value, &hash)){
+                add_to_bin(out, rh_probes(ht->rh, key, hash, ht->key_cmp) - 1);
+            }
+        }
+        break;
+    case HT_SWISS:
+        for (int i = 0; i < sw_capacity(ht->sw); i++){
+            if (sw_slot_get(ht->sw, i, &key, &value, &hash)){
+                add_to_bin(out, sw_probes(ht->sw, key, hash, ht->key_cmp) - 1);
+            }
+        }
+        break;
+    case HT_MAPPED:
+        for (int i = 0; i < snap_num_buckets(ht->snap); i++){
+            add_to_bin(out, snap_bucket_size(ht->snap, i));
+        }
+        break;
+    default:
+        // buckets of the old array that still wait to be migrated count too
+        for (int i = 0; i < ht->num_buckets; i++){
+            add_to_bin(out, list_size(list_array_get(ht->buckets, i)));
+        }
+        for (int i = ht->rehash_idx; ht->old_buckets && i < ht->old_num_buckets; i++){
+            add_to_bin(out, list_size(list_array_get(ht->old_buckets, i)));
+        }
+        break;
+    }
+
+    struct ht_counters* c = ht->stats;
+    if (c == NULL){
+        return;
+    }
+    out->hits = c->hits;
+    out->misses = c->misses;
+    out->avg_probes_hit = c->hits ? (double)c->hit_probes / c->hits : 0;
+    out->avg_probes_miss = c->misses ? (double)c->miss_probes / c->misses : 0;
+    out->max_probes_hit = c->max_hit;
+    out->max_probes_miss = c->max_miss;
+    out->max_filter_adds = c->max_filter;
+    out->resizes = c->resizes;
+    out->resize_ns = c->resize_ns;
+}
+
+
+/*====================================================================================================*/
+
+/*
+ * Function Name: filter_capacity
+ * Description: This function returns the number of entries a table can hold
+ *              at its current capacity before an insert resizes it, the
+ *              Bloom filter is sized for that many
+ * Params:
+ *      ht - the hash table
+ * */
+int filter_capacity(struct ht* ht){
+    int cap = ht_capacity(ht);
+    switch (ht->type){
+    case HT_ROBIN_HOOD:
+        return cap / 4 * 3;
+    case HT_SWISS:
+        return cap / 8 * 7;
+    default:
+        break;
+    }
+    return 4 * cap;
+}
+
+/*
+ * Function Name: filter_entry
+ * Description: This function adds the hash code of one entry to a Bloom
+ *              filter, it is the for_each_entry callback of filter_rebuild
+ * */
+void filter_entry(void* arg, void* key, void* value, unsigned int hash){
+    bloom_add(arg, hash);
+}
+
+/*
+ * Function Name: filter_rebuild
+ * Description: This function replaces the Bloom filter of a table with a
+ *              fresh one sized for the table's capacity and holding the hash
+ *              codes of its entries only, dropping the bits of removed keys
+ * Params:
+ *      ht - hash table with a Bloom filter
+ * */
+void filter_rebuild(struct ht* ht){
+    bloom_free(ht->filter);
+    ht->filter_cap = ht_capacity(ht);
+    ht->filter_keys = filter_capacity(ht);
+    ht->filter = bloom_create(ht->filter_keys);
+    for_each_entry(ht, filter_entry, ht->filter);
+    ht->filter_load = ht_size(ht);
+    if (ht->stats && ht->filter_load > ht->stats->max_filter){
+        ht->stats->max_filter = ht->filter_load;
+    }
+}
+
+/*
+ * Function Name: filter_add
+ * Description: This function adds the hash code of a new entry to the Bloom
+ *              filter of a table, and to the filter that will replace it if
+ *              one is being filled
+ * Params:
+ *      ht - hash table with a Bloom filter
+ *      hash - the hash code of the new entry, see key_hash
+ * */
+void filter_add(struct ht* ht, unsigned int hash){
+    bloom_add(ht->filter, hash);
+    ht->filter_load++;
+    if (ht->next_filter){
+        bloom_add(ht->next_filter, hash);
+    }
+}
+
+/*
+ * Function Name: filter_step
+ * Description: This function adds the entries of up to `steps` more buckets
+ *              of a chained table to the filter being filled.  Once every
+ *              bucket has been added the new filter replaces the old one,
+ *              which answered lookups in the meantime
+ * Params:
+ *      ht - chained hash table whose next filter is being filled
+ *      steps - maximum number of buckets to add
+ * */
+void filter_step(struct ht* ht, int steps){
+    int adds = 0;
+    while (steps-- > 0 && ht->next_idx < ht->num_buckets){
+        struct list* bucket = list_array_get(ht->buckets, ht->next_idx);
+        for (void* curr = head_get(bucket); curr; curr = next_node(curr)){
+            bloom_add(ht->next_filter, node_hash(curr));
+            adds++;
+        }
+        ht->next_idx++;
+    }
+    if (ht->stats && adds > ht->stats->max_filter){
+        ht->stats->max_filter = adds;
+    }
+    if (ht->next_idx == ht->num_buckets){
+        bloom_free(ht->filter);
+        ht->filter = ht->next_filter;
+        ht->next_filter = NULL;
+        ht->filter_cap = ht->num_buckets;
+        ht->filter_keys = filter_capacity(ht);
+        ht->filter_load = ht->size;
+    }
+}
+
+/*
+ * Function Name: filter_update
+ * Description: This function replaces the Bloom filter of a table after the
+ *              table was resized, so it grows and shrinks with the table and
+ *              a shrink after a purge clears the bits of the removed keys.
+ *              Without resizes, removed keys keep their bits, so the filter
+ *              is also replaced once it holds half again as many keys as it
+ *              was sized for.  Open-addressed and inline tables rebuild it
+ *              right away, their resizes walk every entry anyway.  Chained
+ *              tables wait until the resize has moved every entry and then
+ *              fill the new filter HT_REHASH_STEP buckets per insert or
+ *              remove, so like the resize itself no single call walks the
+ *              whole table
+ * Params:
+ *      ht - hash table with a Bloom filter
+ * */
+void filter_update(struct ht* ht){
+    int stale = ht_capacity(ht) != ht->filter_cap
+            || ht->filter_load > ht->filter_keys + ht->filter_keys / 2;
+    if (ht->type != HT_CHAINING || ht->small){
+        if (stale){
+            filter_rebuild(ht);
+        }
+        return;
+    }
+    if (stale && ht->next_filter == NULL && ht->old_buckets == NULL){
+        ht->next_filter = bloom_create(filter_capacity(ht));
+        ht->next_idx = 0;
+    }
+    if (ht->next_filter){
+        filter_step(ht, HT_REHASH_STEP);
+    }
+}
+
+/*
+ * This function turns the Bloom filter of a hash table on or off.  While it
+ * is on, the hash code of every key inserted is also recorded in a blocked
+ * Bloom filter, and lookups only probe the table for keys whose hash code
+ * the filter has seen.  Most lookups of missing keys are then answered by
+ * reading one cache line, without walking a chain or a probe sequence.  The
+ * filter costs about 10 bits per entry the table has room for and one more
+ * cache line read on every lookup that finds its key.  It is rebuilt when
+ * the table resizes and when removed keys have left too many stale bits in
+ * it, so it never loses a key.  A chained table fills the new filter a few
+ * buckets per insert or remove and keeps the old one until it is done.  It
+ * pays off when most lookups miss.
+ *
+ * Params:
+ *   ht - the hash table to configure.  May not be NULL or a mapped table.
+ *   enable - 1 to turn the filter on, 0 to turn it off.
+ */
+void ht_enable_bloom(struct ht* ht, int enable){
+    assert(ht && ht->type != HT_MAPPED);
+    if (ht->filter){
+        bloom_free(ht->filter);
+        ht->filter = NULL;
+    }
+    if (ht->next_filter){
+        bloom_free(ht->next_filter);
+        ht->next_filter = NULL;
+    }
+    if (enable){
+        ht->filter = bloom_create(0);
+        filter_rebuild(ht);
+    }
+}
@@ -9,17 +9,71 @@
 #ifndef __HASH_TABLE_H
 #define __HASH_TABLE_H 
 
+#include <stddef.h>
+
 /*
  * Structure used to represent a hash table.
  */
 struct ht;
 
+/*
+ * Storage engines a hash table can be created with.  HT_CHAINING keeps a
+ * linked list of entries per bucket.  HT_ROBIN_HOOD keeps every entry in one
+ * flat array and resolves collisions with Robin Hood linear probing.
+ * HT_SWISS keeps a control byte with 7 hash bits per slot and matches 16
+ * slots at a time, which suits read-mostly tables.  HT_MAPPED tables are
+ * read-only snapshots opened with ht_open_mapped().
+ */
+enum ht_type {
+    HT_CHAINING,
+    HT_ROBIN_HOOD,
+    HT_SWISS,
+    HT_MAPPED
+};
+
+/*
+ * Statistics about a hash table, filled in by ht_stats().  See ht_stats() in
+ * hash_table.c for what each field counts.
+ */
+#define HT_STATS_BINS 16
+
+struct ht_stats {
+    long occupancy[HT_STATS_BINS];
+    long hits;
+    long misses;
+    double avg_probes_hit;
+    double avg_probes_miss;
+    int max_probes_hit;
+    int max_probes_miss;
+    int max_filter_adds;
+    long resizes;
+    long long resize_ns;
+};
+
+/*
+ * One entry of a hash table, as returned by ht_scan().
+ */
+struct ht_entry {
+    void* key;
+    void* value;
+};
+
 /*
  * Hash table interface function prototypes.  Refer to hash_table.c for
  * documentation about each of these functions.
  */
 void resize(struct ht* ht, int(*convert)(void*));
 struct ht* ht_create();
+struct ht* ht_create_type(enum ht_type type);
+struct ht* ht_create_with_capacity(int n);
+void ht_reserve(struct ht* ht, int n);
+void ht_set_key_cmp(struct ht* ht, int (*cmp)(void* a, void* b));
+void ht_set_seed(struct ht* ht, unsigned int seed);
+void ht_set_resize_threads(struct ht* ht, int threads);
+int ht_capacity(struct ht* ht);
+void ht_enable_stats(struct ht* ht, int enable);
+void ht_stats(struct ht* ht, struct ht_stats* out);
+void ht_enable_bloom(struct ht* ht, int enable);
 int ht_isempty(struct ht* ht);
 int ht_size(struct ht* ht);
 void ht_free(struct ht* t);
@@ -27,6 +81,17 @@ int ht_hash_func(struct ht* ht, void* key, int (*convert)(void*));
 void ht_insert(struct ht* ht, void* key, void* value, int (*convert)(void*));
 void* ht_lookup(struct ht* ht, void* key, int (*convert)(void*));
 void ht_remove(struct ht* ht, void* key, int (*convert)(void*));
+void* ht_upsert(struct ht* ht, void* key, int (*convert)(void*), void* (*init)(void* key, void* arg),
+        void* (*update)(void* value, void* arg), void* arg);
+void ht_lookup_batch(struct ht* ht, void** keys, int n, int (*convert)(void*), void** out);
+void ht_insert_batch(struct ht* ht, void** keys, void** values, int n, int (*convert)(void*));
+void ht_upsert_batch(struct ht* ht, void** keys, void** args, int n, int (*convert)(void*),
+        void* (*init)(void* key, void* arg), void* (*update)(void* value, void* arg));
+void ht_upsert_batch_codes(struct ht* ht, void** keys, int* codes, void** args, int n,
+        void* (*init)(void* key, void* arg), void* (*update)(void* value, void* arg));
+int ht_scan(struct ht* ht, unsigned int* cursor, int batch, struct ht_entry* out);
+int ht_save(struct ht* ht, const char* path, size_t value_size);
+struct ht* ht_open_mapped(const char* path);
 
 
 #endif
@@ -0,0 +1,160 @@
+/*
+ * This file contains fast general purpose hash functions for hash table
+ * keys.  The integer mixers make every output bit depend on every input bit,
+ * so sequential or strided integer keys do not pile up in a few buckets.
+ * The byte string hasher follows the design of wyhash: it reads 8 or 16
+ * bytes at a time and folds them in with 64x64->128 bit multiplications.
+ * See the documentation below for more information on the individual
+ * functions in this implementation.
+ */
+
+#include <string.h>
+#include <stdint.h>
+
+#include "hashers.h"
+
+/*
+ * Odd 64-bit constants with well spread bits, used by hash_bytes.
+ */
+#define HASH_P0 0xa0761d6478bd642fULL
+#define HASH_P1 0xe7037ed1a0b428dbULL
+#define HASH_P2 0x8ebc6af09c88c6e3ULL
+#define HASH_P3 0x589965cc75374cc3ULL
+
+/*
+ * Auxilliary function that multiplies two 64-bit numbers into 128 bits and
+ * folds the high half into the low half.
+ */
+static uint64_t _hash_mum(uint64_t a, uint64_t b) {
+#ifdef __SIZEOF_INT128__
+    __extension__ unsigned __int128 r = (unsigned __int128)a * b;
+    return (uint64_t)r ^ (uint64_t)(r >> 64);
+#else
+    uint64_t ha = a >> 32, la = (uint32_t)a, hb = b >> 32, lb = (uint32_t)b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32), c = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+    c += lo < t;
+    uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+    return lo ^ hi;
+#endif
+}
+
+/*
+ * Auxilliary functions that read 8, 4 or up to 3 bytes from any address.
+ */
+static uint64_t _hash_r8(const uint8_t* p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static uint64_t _hash_r4(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static uint64_t _hash_r3(const uint8_t* p, size_t len) {
+    return ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8) | p[len - 1];
+}
+
+/*
+ * This function scrambles a 32-bit integer so that every bit of the result
+ * depends on every bit of the input.  It is a bijection, so distinct inputs
+ * give distinct outputs.
+ *
+ * Params:
+ *   x - the integer to scramble.
+ */
+unsigned int hash_mix32(unsigned int x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+/*
+ * This function scrambles a 64-bit integer so that every bit of the result
+ * depends on every bit of the input (the splitmix64 finalizer).  It is a
+ * bijection, so distinct inputs give distinct outputs.
+ *
+ * Params:
+ *   x - the integer to scramble.
+ */
+unsigned long long hash_mix64(unsigned long long x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+/*
+ * This function returns a 64-bit hash code of a byte string.  Strings of up
+ * to 16 bytes are hashed with two multiplications, longer ones are consumed
+ * 48 bytes per round in three independent lanes.
+ *
+ * Params:
+ *   data - the bytes to hash.  May only be NULL if `len` is 0.
+ *   len - the number of bytes.
+ *   seed - a value mixed into the result, different seeds give unrelated
+ *     hash codes for the same bytes.
+ */
+unsigned long long hash_bytes(const void* data, size_t len, unsigned long long seed) {
+    const uint8_t* p = data;
+    uint64_t s = seed ^ HASH_P0, a, b;
+
+    if (len <= 16) {
+        if (len >= 4) {
+            size_t mid = (len >> 3) << 2;
+            a = (_hash_r4(p) << 32) | _hash_r4(p + mid);
+            b = (_hash_r4(p + len - 4) << 32) | _hash_r4(p + len - 4 - mid);
+        } else if (len > 0) {
+            a = _hash_r3(p, len);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        if (i > 48) {
+            uint64_t s1 = s, s2 = s;
+            do {
+                s = _hash_mum(_hash_r8(p) ^ HASH_P1, _hash_r8(p + 8) ^ s);
+                s1 = _hash_mum(_hash_r8(p + 16) ^ HASH_P2, _hash_r8(p + 24) ^ s1);
+                s2 = _hash_mum(_hash_r8(p + 32) ^ HASH_P3, _hash_r8(p + 40) ^ s2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            s ^= s1 ^ s2;
+        }
+        while (i > 16) {
+            s = _hash_mum(_hash_r8(p) ^ HASH_P1, _hash_r8(p + 8) ^ s);
+            p += 16;
+            i -= 16;
+        }
+        a = _hash_r8(p + i - 16);
+        b = _hash_r8(p + i - 8);
+    }
+    return _hash_mum(HASH_P1 ^ len, _hash_mum(a ^ HASH_P1, b ^ s));
+}
+
+/*
+ * This is a convert function for keys that point to an int.
+ */
+int ht_hash_int(void* key) {
+    return (int)hash_mix32(*(unsigned int*)key);
+}
+
+/*
+ * This is a convert function for keys that point to a NUL-terminated
+ * string.
+ */
+int ht_hash_string(void* key) {
+    uint64_t h = hash_bytes(key, strlen(key), 0);
+    return (int)(uint32_t)(h ^ (h >> 32));
+}
@@ -0,0 +1,24 @@
+/*
+ * This file contains the definition of the interface for the built-in hash
+ * functions.  ht_hash_int and ht_hash_string can be passed to the ht_*
+ * functions as their `convert` function.  You can find descriptions of the
+ * functions, including their parameters and their return values, in
+ * hashers.c.
+ */
+
+#ifndef __HASHERS_H
+#define __HASHERS_H
+
+#include <stddef.h>
+
+/*
+ * Built-in hash function prototypes.  Refer to hashers.c for documentation
+ * about each of these functions.
+ */
+unsigned int hash_mix32(unsigned int x);
+unsigned long long hash_mix64(unsigned long long x);
+unsigned long long hash_bytes(const void* data, size_t len, unsigned long long seed);
+int ht_hash_int(void* key);
+int ht_hash_string(void* key);
+
+#endif
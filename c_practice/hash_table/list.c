@@ -7,14 +7,20 @@
 #include <stdlib.h>
 #include <assert.h>
 
+#include "node_pool.h"
 #include "list.h"
 
 /*
  * This structure is used to represent a single node in a singly-linked list.
- * It is not defined in list.h, so it is not visible to the user.
+ * It is not defined in list.h, so it is not visible to the user.  Nodes that
+ * are used as hash table entries also keep the key and its full hash code,
+ * so keys can be told apart without calling back into the user's hash
+ * function.
  */
 struct node {
+  void* key;
   void* val;
+  unsigned int hash;
   struct node* next;
 };
 
@@ -26,6 +32,25 @@ struct list {
   struct node* head;
 };
 
+/*
+ * Auxilliary functions that allocate and free a single node.  Nodes come
+ * from `pool` when one is given and from malloc otherwise.
+ */
+static struct node* _node_alloc(struct node_pool* pool) {
+  if (pool) {
+    return pool_alloc(pool);
+  }
+  return malloc(sizeof(struct node));
+}
+
+static void _node_release(struct node_pool* pool, struct node* node) {
+  if (pool) {
+    pool_release(pool, node);
+  } else {
+    free(node);
+  }
+}
+
 /*
  * This function allocates and initializes a new, empty linked list and
  * returns a pointer to it.
@@ -45,16 +70,31 @@ struct list* list_create() {
  *   list - the linked list to be destroyed.  May not be NULL.
  */
 void list_free(struct list* list) {
+  list_release(list, NULL);
+}
+
+/*
+ * This function frees the memory associated with a linked list whose nodes
+ * were allocated from `pool`.  Those nodes are not released one by one, since
+ * the pool's owner frees all of its slabs at once.
+ *
+ * Params:
+ *   list - the linked list to be destroyed.  May not be NULL.
+ *   pool - the pool the nodes came from, or NULL if they came from malloc.
+ */
+void list_release(struct list* list, struct node_pool* pool) {
   assert(list);
 
   /*
    * Free all individual nodes.
    */
-  struct node* next, * curr = list->head;
-  while (curr != NULL) {
-    next = curr->next;
-    free(curr);
-    curr = next;
+  if (pool == NULL) {
+    struct node* next, * curr = list->head;
+    while (curr != NULL) {
+      next = curr->next;
+      free(curr);
+      curr = next;
+    }
   }
 
   free(list);
@@ -75,52 +115,91 @@ void list_insert(struct list* list, void* val) {
   /*
    * Create new node and insert at head.
    */
-  struct node* temp = malloc(sizeof(struct node));
+  list_insert_entry(list, NULL, val, 0, NULL);
+}
+
+/*
+ * This function inserts a new key/value entry with a precomputed hash code
+ * into a given linked list.  The new element is always inserted as the head
+ * of the list and no check for an existing key is made.
+ *
+ * Params:
+ *   list - the linked list into which to insert an element.  May not be NULL.
+ *   key - the key of the entry.
+ *   val - the value of the entry.
+ *   hash - the full hash code of `key`.
+ *   pool - the pool to allocate the node from, or NULL to use malloc.
+ */
+void list_insert_entry(struct list* list, void* key, void* val, unsigned int hash,
+    struct node_pool* pool) {
+  assert(list);
+
+  /*
+   * Create new node and insert at head.
+   */
+  struct node* temp = _node_alloc(pool);
+  temp->key = key;
   temp->val = val;
+  temp->hash = hash;
   temp->next = list->head;
   list->head = temp;
 }
 
 /*
- * This function removes an element with a specified value from a given
- * linked list.  If the specified value appears multiple times in the list,
- * only the *first* instance of that value (i.e. the one nearest to the head
- * of the list) is removed.  This function is passed a function pointer that
- * is used to compare the value `val` to be removed with the values stored in
- * the list to determine which element (if any) to remove.
+ * Auxilliary function that checks whether a node holds a given key.  The
+ * cached hash codes are compared first, so `cmp` is only called when they
+ * match.  Without a `cmp` function equal hash codes mean equal keys.
+ */
+static int _node_matches(struct node* node, void* key, unsigned int hash,
+    int (*cmp)(void* a, void* b)) {
+  return node->hash == hash && (cmp == NULL || cmp(key, node->key) == 0);
+}
+
+/*
+ * This function removes the entry with a specified key from a given linked
+ * list.  If the key appears multiple times in the list, only the *first*
+ * instance of it (i.e. the one nearest to the head of the list) is removed.
+ * An entry matches when its cached hash code equals `hash` and, if a `cmp`
+ * function is given, `cmp` reports the keys as equal.
  *
  * Params:
  *   list - the linked list from which to remove an element.  May not be NULL.
- *   val - the value to be removed.  Note that this parameter has type void*,
- *     which means that a pointer of any type can be passed.
- *   cmp - pointer to a function that can be passed two void* values from
- *     to compare them for equality, as described above.  If the two values
- *     passed are to be considered equal, this function should return 0.
+ *   key - the key of the entry to be removed.
+ *   hash - the full hash code of `key`.
+ *   cmp - pointer to a function that can be passed two keys to compare them
+ *     for equality, or NULL if equal hash codes mean equal keys.  If the two
+ *     keys passed are to be considered equal, this function should return 0.
  *     Otherwise, it should return a non-zero value.
+ *   pool - the pool the nodes came from, or NULL if they came from malloc.
+ *
+ * Return:
+ *   This function returns 1 if an element was removed and 0 otherwise.
  */
-void list_remove(struct list* list, void* val, int (*convert)(void*)) {
+int list_remove(struct list* list, void* key, unsigned int hash,
+    int (*cmp)(void* a, void* b), struct node_pool* pool) {
   assert(list);
 
   struct node* prev = NULL, * curr = list->head;
   while (curr) {
     /*
-     * If current node's value matches query value, update node prior to curr
+     * If current node's key matches query key, update node prior to curr
      * to point around curr, then free curr and return.  This removes curr from
      * the list.
      */
-    if (convert(curr->val) == convert(val)) {
+    if (_node_matches(curr, key, hash, cmp)) {
       if (prev) {
         prev->next = curr->next;
       } else {
         list->head = curr->next;
       }
-      free(curr);
-      return;
+      _node_release(pool, curr);
+      return 1;
     }
 
     prev = curr;
     curr = curr->next;
   }
+  return 0;
 }
 
 /*
@@ -233,6 +312,83 @@ void* head_get(struct list* list){
     return list->head;
 }
 
+/*
+ * Function Name: list_find
+ * Description: this function returns the first node holding a key, or NULL
+ *              if the key is not in the list.  Nodes are rejected on their
+ *              cached hash code before `cmp` is ever called
+ * Params: 
+ *      list - the list to search
+ *      key - the key to search for
+ *      hash - the full hash code of the key
+ *      cmp - compares two keys, returns 0 when they are equal.  May be NULL,
+ *            then equal hash codes mean equal keys
+ * */
+void* list_find(struct list *list, void* key, unsigned int hash, int (*cmp)(void* a, void* b)){
+    struct node *curr = list->head;
+
+    while(curr){
+        if (_node_matches(curr, key, hash, cmp)){
+            return curr;
+        }
+        curr = curr->next;
+    }
+    return NULL;
+}
+
+/*
+ * Function Name: list_probes
+ * Description: this function returns the number of nodes list_find looks at
+ *              when searching for a key, whether or not the key is found.
+ *              It is only meant for statistics
+ * Params: 
+ *      list - the list to search
+ *      key - the key to search for
+ *      hash - the full hash code of the key
+ *      cmp - compares two keys, returns 0 when they are equal.  May be NULL,
+ *            then equal hash codes mean equal keys
+ * */
+int list_probes(struct list *list, void* key, unsigned int hash, int (*cmp)(void* a, void* b)){
+    struct node *curr = list->head;
+    int probes = 0;
+
+    while(curr){
+        probes++;
+        if (_node_matches(curr, key, hash, cmp)){
+            break;
+        }
+        curr = curr->next;
+    }
+    return probes;
+}
+
+/*
+ * Function Name: list_upsert
+ * Description: this function finds the node of a key, inserting one with a
+ *              NULL value at the head if there is none, and returns where
+ *              its value is stored so it can be read and updated in place.
+ *              Nodes are never moved or copied, so the pointer stays valid
+ *              until the node is removed
+ * Params: 
+ *      list - the list to search and insert into
+ *      key - the key associated with the value
+ *      hash - the full hash code of the key
+ *      cmp - compares two keys, returns 0 when they are equal.  May be NULL,
+ *            then equal hash codes mean equal keys
+ *      pool - the pool new nodes are allocated from, NULL to use malloc
+ *      created - set to 1 if a node was inserted, 0 if the key was found
+ * */
+void** list_upsert(struct list *list, void* key, unsigned int hash, int (*cmp)(void* a, void* b),
+    struct node_pool* pool, int* created){
+    struct node *curr = list_find(list, key, hash, cmp);
+    *created = curr == NULL;
+    if (curr == NULL){
+        list_insert_entry(list, key, NULL, hash, pool);
+        curr = list->head;
+    }
+    return &curr->val;
+}
+
 /*
  * Function Name: list_insert_key
  * Description: this function inserts a value into the list. 
@@ -240,25 +396,22 @@ void* head_get(struct list* list){
  *              if does it updates the value, else it inserts it                 
  * Params: 
  *      list - the linked where the value will be inserted into 
- *      val - the value to be inserted 
  *      key - the key associated with the value
- *      convert - will be used to check the hash code of a value/key 
+ *      val - the value to be inserted 
+ *      hash - the full hash code of the key
+ *      cmp - compares two keys, returns 0 when they are equal.  May be NULL,
+ *            then equal hash codes mean equal keys
+ *      pool - the pool new nodes are allocated from, NULL to use malloc
+ * Return:
+ *      1 if the value was inserted as a new element, 0 if an existing
+ *      element was updated
  * */
-void list_insert_key(struct list *list, void* val, void* key, int(*convert)(void*)){
-    struct node *curr = list->head;
-    
-    while(curr){
-        // checks if there is key that already exist at this key
-        // updates if so
-        if (convert(curr->val) == convert(key)){
-            curr->val = val;
-            return;
-        }
-        curr = curr->next;
-    }
-    // if it passes all the checks it is inserted into the list
-    list_insert(list, val);
-    return;
+int list_insert_key(struct list *list, void* key, void* val, unsigned int hash, int (*cmp)(void* a, void* b),
+    struct node_pool* pool){
+    // finds the key or inserts a node for it, then stores the value
+    int created;
+    *list_upsert(list, key, hash, cmp, pool, &created) = val;
+    return created;
 }
 
 /*
@@ -284,4 +437,103 @@ void* node_val(void* node){
 
 }
 
+/*
+ * Function Name: node_key
+ * Description: this function will return the key of a node
+ *              , for when the key can't be accessed directly
+ * Param:
+ *      node - the node we want the key of
+ */
+void* node_key(void* node){
+    return ((struct node*)node)->key;
+}
+
+/*
+ * Function Name: node_hash
+ * Description: this function will return the cached hash code of a node
+ *              , for when the hash code can't be accessed directly
+ * Param:
+ *      node - the node we want the hash code of
+ */
+unsigned int node_hash(void* node){
+    return ((struct node*)node)->hash;
+}
+
+/*
+ * Function Name: list_move_head
+ * Description: this function unlinks the head node of one list and makes it
+ *              the head of another list.  The node itself is not copied, so
+ *              entries can change lists without allocating or freeing
+ * Params:
+ *      src - the list whose head node is moved, may not be empty
+ *      dst - the list that receives the node
+ */
+void list_move_head(struct list* src, struct list* dst){
+    struct node* node = src->head;
+    src->head = node->next;
+    node->next = dst->head;
+    dst->head = node;
+}
+
+/*
+ * Function Name: list_node_size
+ * Description: this function returns the size of a list node, for callers
+ *              that set up a node_pool for their lists
+ */
+size_t list_node_size(){
+    return sizeof(struct node);
+}
+
+/*
+ * Function Name: list_array_create
+ * Description: this function allocates an array of `n` empty lists stored
+ *              next to each other, so each list is just a head pointer
+ *              inside the array.  No list gets any storage of its own until
+ *              a node is inserted into it
+ * Params:
+ *      n - the number of lists
+ */
+struct list* list_array_create(int n){
+    struct list* lists = calloc(n, sizeof(struct list));
+    assert(lists);
+    return lists;
+}
+
+/*
+ * Function Name: list_array_get
+ * Description: this function returns list `idx` of an array made by
+ *              list_array_create, it can be passed to every list function
+ *              except list_free and list_release
+ * Params:
+ *      lists - the array of lists
+ *      idx - the index of the list
+ */
+struct list* list_array_get(struct list* lists, int idx){
+    return &lists[idx];
+}
+
+/*
+ * Function Name: list_array_free
+ * Description: this function frees an array made by list_array_create.
+ *              The nodes of its lists are freed one by one unless they came
+ *              from a pool, the pool's owner frees those all at once
+ * Params:
+ *      lists - the array of lists
+ *      n - the number of lists
+ *      pool - the pool the nodes came from, NULL if they came from malloc
+ */
+void list_array_free(struct list* lists, int n, struct node_pool* pool){
+    if (pool == NULL){
+        for (int i = 0; i < n; i++){
+            struct node* next, * curr = lists[i].head;
+            while (curr){
+                next = curr->next;
+                free(curr);
+                curr = next;
+            }
+        }
+    }
+    free(lists);
+}
+
 /*====================================================================================================*/
@@ -9,6 +9,10 @@
 #ifndef __LIST_H
 #define __LIST_H
 
+#include <stddef.h>
+
+struct node_pool;
+
 /*
  * Structure used to represent a singly-linked list.  You may not change the
  * fact that only a forward declaration of the list structure is included
@@ -23,14 +27,30 @@ struct list;
 struct list* list_create();
 void list_free(struct list* list);
 void list_insert(struct list* list, void* val);
-void list_remove(struct list* list, void* val, int (*convert)(void*));
+void list_release(struct list* list, struct node_pool* pool);
+void list_insert_entry(struct list* list, void* key, void* val, unsigned int hash,
+    struct node_pool* pool);
+int list_remove(struct list* list, void* key, unsigned int hash,
+    int (*cmp)(void* a, void* b), struct node_pool* pool);
 int list_position(struct list* list, void* val, int (*cmp)(void* a, void* b));
 void list_reverse(struct list* list);
 
 int list_empty(struct list* list);
 int list_size(struct list* list);
 void* head_get(struct list* list);
-void list_insert_key(struct list *list, void* val, void* key, int(*convert)(void*));
+int list_insert_key(struct list *list, void* key, void* val, unsigned int hash, int (*cmp)(void* a, void* b),
+    struct node_pool* pool);
+void** list_upsert(struct list *list, void* key, unsigned int hash, int (*cmp)(void* a, void* b),
+    struct node_pool* pool, int* created);
+void* list_find(struct list *list, void* key, unsigned int hash, int (*cmp)(void* a, void* b));
+int list_probes(struct list *list, void* key, unsigned int hash, int (*cmp)(void* a, void* b));
 void* next_node(void* node);
 void* node_val(void* node);
+void* node_key(void* node);
+unsigned int node_hash(void* node);
+void list_move_head(struct list* src, struct list* dst);
+size_t list_node_size();
+struct list* list_array_create(int n);
+struct list* list_array_get(struct list* lists, int idx);
+void list_array_free(struct list* lists, int n, struct node_pool* pool);
 #endif
@@ -0,0 +1,306 @@
+/*
+ * This file contains a bounded least-recently-used cache.  Entries are kept
+ * on an intrusive doubly-linked list ordered from most to least recently
+ * used, and a hash table maps every key straight to its list entry.  Finding
+ * an entry, moving it to the front and evicting the entry at the back are
+ * all O(1); no operation ever walks the list.  Entries come from a node pool
+ * and an evicted entry is reused for the key that pushed it out.  See the
+ * documentation below for more information on the individual functions in
+ * this implementation.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "hash_table.h"
+#include "node_pool.h"
+#include "lru.h"
+
+/*
+ * This structure represents one cached entry.  `prev` points towards the
+ * most recently used end of the list and `next` towards the least recently
+ * used end.
+ */
+struct lru_entry {
+    void* key;
+    void* value;
+    struct lru_entry* prev;
+    struct lru_entry* next;
+};
+
+/*
+ * This structure represents the whole cache.  `head` is the most recently
+ * used entry and `tail` the next one to be evicted.  The table maps keys to
+ * their entries and is reserved up front for `capacity` keys plus the one a
+ * put adds before it evicts, so it does not grow while the cache fills up.
+ * The deleted slots evictions leave behind can make it double once later,
+ * after which it only drops them in place.
+ */
+struct lru {
+    struct ht* map;
+    int (*convert)(void*);
+    struct node_pool* entries;
+    struct lru_entry* head;
+    struct lru_entry* tail;
+    int size;
+    int capacity;
+    void (*evict)(void* arg, void* key, void* value);
+    void* evict_arg;
+    struct lru_stats stats;
+};
+
+/*
+ * Auxilliary function that takes an entry off the list.
+ */
+static void _lru_unlink(struct lru* c, struct lru_entry* e) {
+    if (e->prev) {
+        e->prev->next = e->next;
+    } else {
+        c->head = e->next;
+    }
+    if (e->next) {
+        e->next->prev = e->prev;
+    } else {
+        c->tail = e->prev;
+    }
+}
+
+/*
+ * Auxilliary function that puts an entry that is not on the list at its
+ * most recently used end.
+ */
+static void _lru_push_front(struct lru* c, struct lru_entry* e) {
+    e->prev = NULL;
+    e->next = c->head;
+    if (c->head) {
+        c->head->prev = e;
+    } else {
+        c->tail = e;
+    }
+    c->head = e;
+}
+
+/*
+ * Auxilliary function that marks an entry as the most recently used one.
+ */
+static void _lru_touch(struct lru* c, struct lru_entry* e) {
+    if (c->head != e) {
+        _lru_unlink(c, e);
+        _lru_push_front(c, e);
+    }
+}
+
+/*
+ * This function allocates and initializes an empty cache and returns a
+ * pointer to it.
+ *
+ * Params:
+ *   capacity - the most entries the cache holds.  Must be at least 1.
+ *   convert - pointer to a function that can be passed a key to convert it
+ *     to an integer hash code, as for the ht_* functions.
+ */
+struct lru* lru_create(int capacity, int (*convert)(void*)) {
+    assert(capacity > 0 && convert);
+    struct lru* c = malloc(sizeof(struct lru));
+    assert(c);
+    c->map = ht_create_type(HT_SWISS);
+    ht_reserve(c->map, capacity + 1);
+    c->convert = convert;
+    c->entries = pool_create(sizeof(struct lru_entry));
+    c->head = NULL;
+    c->tail = NULL;
+    c->size = 0;
+    c->capacity = capacity;
+    c->evict = NULL;
+    c->evict_arg = NULL;
+    memset(&c->stats, 0, sizeof(c->stats));
+    return c;
+}
+
+/*
+ * This function frees the memory associated with a cache.  The eviction
+ * function is not called for the entries still cached, and keys and values
+ * are owned by the caller and are not freed.
+ *
+ * Params:
+ *   c - the cache to be destroyed.  May not be NULL.
+ */
+void lru_free(struct lru* c) {
+    assert(c);
+    ht_free(c->map);
+    pool_free(c->entries);
+    free(c);
+}
+
+/*
+ * This function sets the function used to tell two keys apart, see
+ * ht_set_key_cmp().  It may only be called while the cache is empty.
+ *
+ * Params:
+ *   c - the cache to configure.  May not be NULL.
+ *   cmp - returns 0 when two keys are equal, or NULL if keys with the same
+ *     hash code are the same key (the default).
+ */
+void lru_set_key_cmp(struct lru* c, int (*cmp)(void* a, void* b)) {
+    assert(c && c->size == 0);
+    ht_set_key_cmp(c->map, cmp);
+}
+
+/*
+ * This function sets the function called with every entry the cache evicts
+ * to make room for a new one.  It is called after the entry has left the
+ * cache, so it may free the key and the value.
+ *
+ * Params:
+ *   c - the cache to configure.  May not be NULL.
+ *   evict - called with `arg` and the key and value of the evicted entry,
+ *     or NULL to stop calling anything.
+ *   arg - passed through to `evict`.
+ */
+void lru_set_evict(struct lru* c, void (*evict)(void* arg, void* key, void* value), void* arg) {
+    assert(c);
+    c->evict = evict;
+    c->evict_arg = arg;
+}
+
+/*
+ * This function returns the value cached under a key and marks the entry as
+ * the most recently used one, or returns NULL if the key is not cached.
+ *
+ * Params:
+ *   c - the cache to search.  May not be NULL.
+ *   key - the key to search for.
+ */
+void* lru_get(struct lru* c, void* key) {
+    assert(c);
+    struct lru_entry* e = ht_lookup(c->map, key, c->convert);
+    if (e == NULL) {
+        c->stats.misses++;
+        return NULL;
+    }
+    c->stats.hits++;
+    _lru_touch(c, e);
+    return e->value;
+}
+
+/*
+ * This structure carries the arguments of lru_put() through ht_upsert() to
+ * the functions below, and brings back the entry that was evicted, if any.
+ */
+struct lru_put_args {
+    struct lru* c;
+    void* value;
+    int evicted;
+    void* evicted_key;
+    void* evicted_value;
+};
+
+/*
+ * Auxilliary functions that ht_upsert() calls from lru_put().  A new key
+ * takes a fresh entry, or the least recently used one when the cache is
+ * full; that entry is only taken off the list here, since the table cannot
+ * be changed while ht_upsert() runs.  A cached key gets its value replaced.
+ */
+static void* _lru_put_new(void* key, void* arg) {
+    struct lru_put_args* a = arg;
+    struct lru* c = a->c;
+    struct lru_entry* e;
+    if (c->size == c->capacity) {
+        e = c->tail;
+        _lru_unlink(c, e);
+        a->evicted = 1;
+        a->evicted_key = e->key;
+        a->evicted_value = e->value;
+    } else {
+        e = pool_alloc(c->entries);
+        c->size++;
+    }
+    e->key = key;
+    e->value = a->value;
+    _lru_push_front(c, e);
+    return e;
+}
+
+static void* _lru_put_update(void* value, void* arg) {
+    struct lru_put_args* a = arg;
+    struct lru_entry* e = value;
+    e->value = a->value;
+    _lru_touch(a->c, e);
+    return e;
+}
+
+/*
+ * This function caches a value under a key and marks the entry as the most
+ * recently used one.  If the key is already cached its value is replaced.
+ * Otherwise, when the cache is full, the least recently used entry is
+ * evicted first and handed to the eviction function.
+ *
+ * Params:
+ *   c - the cache into which to insert.  May not be NULL.
+ *   key - the key of the entry.
+ *   value - the value to be cached.
+ */
+void lru_put(struct lru* c, void* key, void* value) {
+    assert(c);
+    struct lru_put_args a = { c, value, 0, NULL, NULL };
+    // one probe finds the key or adds it, the evicted key, whose entry now
+    // holds the new one, leaves the table afterwards
+    ht_upsert(c->map, key, c->convert, _lru_put_new, _lru_put_update, &a);
+    if (a.evicted) {
+        ht_remove(c->map, a.evicted_key, c->convert);
+        c->stats.evictions++;
+        if (c->evict) {
+            c->evict(c->evict_arg, a.evicted_key, a.evicted_value);
+        }
+    }
+}
+
+/*
+ * This function drops the entry cached under a key, if any.  The eviction
+ * function is not called.
+ *
+ * Params:
+ *   c - the cache from which to remove.  May not be NULL.
+ *   key - the key to remove.
+ */
+void lru_remove(struct lru* c, void* key) {
+    assert(c);
+    struct lru_entry* e = ht_lookup(c->map, key, c->convert);
+    if (e == NULL) {
+        return;
+    }
+    _lru_unlink(c, e);
+    ht_remove(c->map, key, c->convert);
+    pool_release(c->entries, e);
+    c->size--;
+}
+
+/*
+ * This function returns the number of entries in a cache.
+ */
+int lru_size(struct lru* c) {
+    assert(c);
+    return c->size;
+}
+
+/*
+ * This function returns the most entries a cache holds.
+ */
+int lru_capacity(struct lru* c) {
+    assert(c);
+    return c->capacity;
+}
+
+/*
+ * This function reports how many lru_get() calls found their key, how many
+ * did not, and how many entries were evicted since the cache was created.
+ *
+ * Params:
+ *   c - the cache.  May not be NULL.
+ *   out - receives the counters.  May not be NULL.
+ */
+void lru_stats(struct lru* c, struct lru_stats* out) {
+    assert(c && out);
+    *out = c->stats;
+}
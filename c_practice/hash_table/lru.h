@@ -0,0 +1,40 @@
+/*
+ * This file contains the definition of the interface for a bounded cache
+ * that evicts its least recently used entry when it is full.  You can find
+ * descriptions of the cache functions, including their parameters and their
+ * return values, in lru.c.
+ */
+
+#ifndef __LRU_H
+#define __LRU_H
+
+/*
+ * Structure used to represent a cache.
+ */
+struct lru;
+
+/*
+ * Counters kept by a cache since it was created, filled in by lru_stats().
+ */
+struct lru_stats {
+    long hits;
+    long misses;
+    long evictions;
+};
+
+/*
+ * Cache interface function prototypes.  Refer to lru.c for documentation
+ * about each of these functions.
+ */
+struct lru* lru_create(int capacity, int (*convert)(void*));
+void lru_free(struct lru* c);
+void lru_set_key_cmp(struct lru* c, int (*cmp)(void* a, void* b));
+void lru_set_evict(struct lru* c, void (*evict)(void* arg, void* key, void* value), void* arg);
+void* lru_get(struct lru* c, void* key);
+void lru_put(struct lru* c, void* key, void* value);
+void lru_remove(struct lru* c, void* key);
+int lru_size(struct lru* c);
+int lru_capacity(struct lru* c);
+void lru_stats(struct lru* c, struct lru_stats* out);
+
+#endif
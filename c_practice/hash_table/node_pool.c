@@ -0,0 +1,161 @@
+/*
+ * This file contains a pool allocator for objects of one fixed size.  Objects
+ * are carved one after the other out of large slabs, so they carry none of
+ * malloc's per-allocation header and sit next to each other in memory.
+ * Released objects go onto a freelist and are handed out again before the
+ * slab is touched.  The pool never returns single objects to malloc; all
+ * slabs are released at once when the pool is freed.  See the documentation
+ * below for more information on the individual functions in this
+ * implementation.
+ */
+
+#include <stdlib.h>
+#include <assert.h>
+
+#include "node_pool.h"
+
+/*
+ * Number of bytes requested from malloc for every slab.
+ */
+#define POOL_SLAB_BYTES (1 << 16)
+
+/*
+ * This structure is the header at the start of every slab.  Slabs are kept
+ * in a singly-linked list so they can all be freed together.
+ */
+struct pool_slab {
+    struct pool_slab* next;
+};
+
+/*
+ * This structure represents the whole pool.  `bump` points at the next
+ * never-used object of the newest slab and `bump_left` counts how many such
+ * objects remain.  Released objects are chained through their first word on
+ * `free_list`.
+ */
+struct node_pool {
+    size_t obj_size;
+    int objs_per_slab;
+    struct pool_slab* slabs;
+    int num_slabs;
+    char* bump;
+    int bump_left;
+    void* free_list;
+    long in_use;
+};
+
+/*
+ * Auxilliary function that rounds a size up to a multiple of the pointer
+ * size, so every object is aligned for the pointers stored in it.
+ */
+static size_t _pool_align(size_t size) {
+    size_t a = sizeof(void*);
+    return (size + a - 1) / a * a;
+}
+
+/*
+ * This function allocates and initializes a new, empty pool and returns a
+ * pointer to it.  No slab is allocated until the first object is.
+ *
+ * Params:
+ *   obj_size - the size in bytes of every object handed out by the pool.
+ *     Objects smaller than a pointer are rounded up to one.
+ */
+struct node_pool* pool_create(size_t obj_size) {
+    struct node_pool* pool = malloc(sizeof(struct node_pool));
+    assert(pool);
+    pool->obj_size = _pool_align(obj_size < sizeof(void*) ? sizeof(void*) : obj_size);
+    pool->objs_per_slab = (POOL_SLAB_BYTES - _pool_align(sizeof(struct pool_slab)))
+        / pool->obj_size;
+    assert(pool->objs_per_slab > 0);
+    pool->slabs = NULL;
+    pool->num_slabs = 0;
+    pool->bump = NULL;
+    pool->bump_left = 0;
+    pool->free_list = NULL;
+    pool->in_use = 0;
+    return pool;
+}
+
+/*
+ * This function frees a pool together with every object it ever handed out,
+ * one free() per slab.  Objects still in use become invalid.
+ *
+ * Params:
+ *   pool - the pool to be destroyed.  May not be NULL.
+ */
+void pool_free(struct node_pool* pool) {
+    assert(pool);
+    struct pool_slab* next, * curr = pool->slabs;
+    while (curr) {
+        next = curr->next;
+        free(curr);
+        curr = next;
+    }
+    free(pool);
+}
+
+/*
+ * This function returns an uninitialized object of the pool's object size.
+ * Objects from the freelist are reused first, then the newest slab is used
+ * up, and only then is a new slab allocated.
+ *
+ * Params:
+ *   pool - the pool to allocate from.  May not be NULL.
+ */
+void* pool_alloc(struct node_pool* pool) {
+    assert(pool);
+    void* obj;
+
+    if (pool->free_list) {
+        obj = pool->free_list;
+        pool->free_list = *(void**)obj;
+    } else {
+        if (pool->bump_left == 0) {
+            struct pool_slab* slab = malloc(POOL_SLAB_BYTES);
+            assert(slab);
+            slab->next = pool->slabs;
+            pool->slabs = slab;
+            pool->num_slabs++;
+            pool->bump = (char*)slab + _pool_align(sizeof(struct pool_slab));
+            pool->bump_left = pool->objs_per_slab;
+        }
+        obj = pool->bump;
+        pool->bump += pool->obj_size;
+        pool->bump_left--;
+    }
+    pool->in_use++;
+    return obj;
+}
+
+/*
+ * This function gives an object back to the pool.  It is put on the
+ * freelist and handed out again by a later pool_alloc().
+ *
+ * Params:
+ *   pool - the pool the object was allocated from.  May not be NULL.
+ *   obj - the object to release.  May not be NULL.
+ */
+void pool_release(struct node_pool* pool, void* obj) {
+    assert(pool && obj);
+    *(void**)obj = pool->free_list;
+    pool->free_list = obj;
+    pool->in_use--;
+}
+
+/*
+ * This function returns the number of objects currently handed out.
+ */
+long pool_in_use(struct node_pool* pool) {
+    assert(pool);
+    return pool->in_use;
+}
+
+/*
+ * This function returns the number of bytes the pool holds from malloc,
+ * counting whole slabs.
+ */
+size_t pool_bytes(struct node_pool* pool) {
+    assert(pool);
+    return (size_t)pool->num_slabs * POOL_SLAB_BYTES + sizeof(struct node_pool);
+}
@@ -0,0 +1,30 @@
+/*
+ * This file contains the definition of the interface for a pool allocator
+ * that hands out fixed-size objects carved from large slabs.  Chained hash
+ * tables use it for their list nodes.  You can find descriptions of the
+ * functions, including their parameters and their return values, in
+ * node_pool.c.
+ */
+
+#ifndef __NODE_POOL_H
+#define __NODE_POOL_H
+
+#include <stddef.h>
+
+/*
+ * Structure used to represent a node pool.
+ */
+struct node_pool;
+
+/*
+ * Node pool interface function prototypes.  Refer to node_pool.c for
+ * documentation about each of these functions.
+ */
+struct node_pool* pool_create(size_t obj_size);
+void pool_free(struct node_pool* pool);
+void* pool_alloc(struct node_pool* pool);
+void pool_release(struct node_pool* pool, void* obj);
+long pool_in_use(struct node_pool* pool);
+size_t pool_bytes(struct node_pool* pool);
+
+#endif
@@ -0,0 +1,436 @@
+/*
+ * This file contains an open-addressing table that resolves collisions with
+ * Robin Hood linear probing.  Every entry lives in one flat array of slots,
+ * so a lookup walks consecutive memory instead of chasing list nodes.  See
+ * the documentation below for more information on the individual functions
+ * in this implementation.
+ */
+
+#include <stdlib.h>
+#include <assert.h>
+
+#include "robin_hood.h"
+
+/*
+ * This structure represents a single slot of the table.  `dist` is the
+ * distance of the entry from its home slot plus one, so a slot with a
+ * `dist` of 0 is empty.  Keeping the distance in the slot lets probes stop
+ * as soon as they reach an entry that is closer to home than the key being
+ * searched for would be.
+ */
+struct rh_slot {
+    void* key;
+    void* value;
+    unsigned int hash;
+    unsigned int dist;
+};
+
+/*
+ * This structure represents the whole table.  `capacity` is always a power
+ * of two and `shift` is the number of bits dropped from the hash code to
+ * turn it into a slot index.  The table never shrinks below `min_capacity`.
+ */
+struct rh_table {
+    struct rh_slot* slots;
+    int capacity;
+    int shift;
+    int size;
+    int min_capacity;
+};
+
+#define RH_INIT_CAPACITY 8
+#define RH_INIT_SHIFT 29
+
+/*
+ * Auxilliary function that allocates an array of `capacity` empty slots.
+ */
+static struct rh_slot* _rh_alloc_slots(int capacity) {
+    struct rh_slot* slots = calloc(capacity, sizeof(struct rh_slot));
+    assert(slots);
+    return slots;
+}
+
+/*
+ * This function allocates and initializes a new, empty Robin Hood table and
+ * returns a pointer to it.
+ */
+struct rh_table* rh_create() {
+    struct rh_table* t = malloc(sizeof(struct rh_table));
+    assert(t);
+    t->slots = _rh_alloc_slots(RH_INIT_CAPACITY);
+    t->capacity = RH_INIT_CAPACITY;
+    t->shift = RH_INIT_SHIFT;
+    t->size = 0;
+    t->min_capacity = RH_INIT_CAPACITY;
+    return t;
+}
+
+/*
+ * This function frees the memory associated with a Robin Hood table.  Keys
+ * and values stored in the table are owned by the caller and are not freed.
+ *
+ * Params:
+ *   t - the table to be destroyed.  May not be NULL.
+ */
+void rh_free(struct rh_table* t) {
+    assert(t);
+    free(t->slots);
+    free(t);
+}
+
+/*
+ * This function returns the number of entries stored in a table.
+ */
+int rh_size(struct rh_table* t) {
+    assert(t);
+    return t->size;
+}
+
+/*
+ * This function returns the number of slots in a table.
+ */
+int rh_capacity(struct rh_table* t) {
+    assert(t);
+    return t->capacity;
+}
+
+/*
+ * This function maps a hash code to the home slot of the entry.  The hash
+ * code is expected to be mixed already, so its top bits are used as is.
+ *
+ * Params:
+ *   t - the table whose slot is being computed.  May not be NULL.
+ *   hash - the hash code of the key.
+ */
+int rh_home(struct rh_table* t, unsigned int hash) {
+    return (int)(hash >> t->shift);
+}
+
+/*
+ * This function asks the CPU to start loading the home slot of a hash code,
+ * so a lookup that follows shortly after does not wait for memory.
+ *
+ * Params:
+ *   t - the table that will be probed.  May not be NULL.
+ *   hash - the hash code of the key.
+ */
+void rh_prefetch(struct rh_table* t, unsigned int hash) {
+    __builtin_prefetch(&t->slots[rh_home(t, hash)]);
+}
+
+/*
+ * This function reads the entry stored in one slot of a table, so callers
+ * can visit every entry by walking the slots from 0 to the capacity.
+ *
+ * Params:
+ *   t - the table to read.  May not be NULL.
+ *   idx - the slot index, between 0 and the table's capacity.
+ *   key, value, hash - receive the entry stored in the slot, if any.
+ *
+ * Return:
+ *   This function returns 1 if the slot holds an entry and 0 if it is empty.
+ */
+int rh_slot_get(struct rh_table* t, int idx, void** key, void** value, unsigned int* hash) {
+    assert(t && idx >= 0 && idx < t->capacity);
+    if (t->slots[idx].dist == 0) {
+        return 0;
+    }
+    *key = t->slots[idx].key;
+    *value = t->slots[idx].value;
+    *hash = t->slots[idx].hash;
+    return 1;
+}
+
+/*
+ * This function visits every entry whose home is a given slot, wherever the
+ * entry was moved by probing.  Entries sharing a home sit next to each other
+ * after the entries with earlier homes, so the walk stops at the first slot
+ * whose entry has a later home.  Together the homes 0 to the capacity - 1
+ * visit every entry exactly once.
+ *
+ * Params:
+ *   t - the table to walk.  May not be NULL.
+ *   home - the home slot, between 0 and the table's capacity.
+ *   fn - called with `arg` and the key and value of every entry.
+ *   arg - passed through to `fn`.
+ *
+ * Return:
+ *   This function returns the number of entries visited.
+ */
+int rh_scan_home(struct rh_table* t, int home, void (*fn)(void* arg, void* key, void* value),
+        void* arg) {
+    assert(t && home >= 0 && home < t->capacity);
+    int mask = t->capacity - 1;
+    int idx = home;
+    unsigned int dist = 1;
+    int count = 0;
+
+    while (t->slots[idx].dist >= dist) {
+        if (t->slots[idx].dist == dist) {
+            fn(arg, t->slots[idx].key, t->slots[idx].value);
+            count++;
+        }
+        idx = (idx + 1) & mask;
+        dist++;
+    }
+    return count;
+}
+
+/*
+ * Auxilliary function that places an entry that is known not to be in the
+ * table yet, starting the probe at slot `idx` with `entry.dist` already set
+ * to the distance of that slot from home.  Whenever the entry being placed
+ * is further from home than the entry occupying a slot, the two are swapped
+ * and the displaced entry keeps probing.  This keeps probe lengths even
+ * across the whole table.
+ */
+static void _rh_place(struct rh_table* t, struct rh_slot entry, int idx) {
+    int mask = t->capacity - 1;
+
+    while (t->slots[idx].dist != 0) {
+        if (t->slots[idx].dist < entry.dist) {
+            struct rh_slot tmp = t->slots[idx];
+            t->slots[idx] = entry;
+            entry = tmp;
+        }
+        idx = (idx + 1) & mask;
+        entry.dist++;
+    }
+    t->slots[idx] = entry;
+}
+
+/*
+ * Auxilliary function that moves every entry into a freshly allocated array
+ * of `capacity` slots, re-placing each one according to its cached hash
+ * code.
+ */
+static void _rh_resize(struct rh_table* t, int capacity) {
+    struct rh_slot* old = t->slots;
+    int old_cap = t->capacity;
+
+    t->slots = _rh_alloc_slots(capacity);
+    t->capacity = capacity;
+    t->shift = 32 - __builtin_ctz(capacity);
+
+    for (int i = 0; i < old_cap; i++) {
+        if (old[i].dist != 0) {
+            old[i].dist = 1;
+            _rh_place(t, old[i], rh_home(t, old[i].hash));
+        }
+    }
+    free(old);
+}
+
+/*
+ * This function doubles the number of slots in a table and re-places every
+ * entry according to its cached hash code.
+ *
+ * Params:
+ *   t - the table to grow.  May not be NULL.
+ */
+void rh_grow(struct rh_table* t) {
+    assert(t);
+    _rh_resize(t, t->capacity * 2);
+}
+
+/*
+ * This function makes sure a table can hold `n` entries without growing,
+ * and keeps it from shrinking below that size when entries are removed.
+ *
+ * Params:
+ *   t - the table to size.  May not be NULL.
+ *   n - the number of entries to make room for.
+ */
+void rh_reserve(struct rh_table* t, int n) {
+    assert(t && n >= 0);
+    int capacity = RH_INIT_CAPACITY;
+    while (n * 4 > capacity * 3) {
+        capacity *= 2;
+    }
+    t->min_capacity = capacity;
+    if (capacity > t->capacity) {
+        _rh_resize(t, capacity);
+    }
+}
+
+/*
+ * Auxilliary function that checks whether a slot holds a given key.  Slots
+ * are rejected on their cached hash code before `cmp` is ever called.
+ */
+static int _rh_matches(struct rh_slot* slot, void* key, unsigned int hash,
+        int (*cmp)(void* a, void* b)) {
+    return slot->hash == hash && (cmp == NULL || cmp(key, slot->key) == 0);
+}
+
+/*
+ * This function finds the entry of a key, adding one with a NULL value if
+ * there is none, and returns where its value is stored, so the caller can
+ * read and update the value without a second probe.  The table is doubled
+ * before an insertion would push the load factor past 0.75.
+ *
+ * Params:
+ *   t - the table to search and insert into.  May not be NULL.
+ *   key - the key of the entry.
+ *   hash - the hash code of `key`.
+ *   cmp - compares two keys and returns 0 when they are equal, or NULL if
+ *     equal hash codes mean equal keys.
+ *   created - set to 1 if the entry was added and to 0 if it existed.
+ *
+ * Return:
+ *   This function returns a pointer to the value of the entry.  It is only
+ *   valid until the table is changed again.
+ */
+void** rh_upsert(struct rh_table* t, void* key, unsigned int hash,
+        int (*cmp)(void* a, void* b), int* created) {
+    assert(t && created);
+    if ((t->size + 1) * 4 > t->capacity * 3) {
+        rh_grow(t);
+    }
+
+    int mask = t->capacity - 1;
+    int idx = rh_home(t, hash);
+    unsigned int dist = 1;
+
+    /*
+     * Look for the key up to the first slot that is closer to its home than
+     * the key would be.  By the Robin Hood invariant the key cannot live
+     * beyond that slot, so that is where the new entry belongs.
+     */
+    while (t->slots[idx].dist >= dist) {
+        if (_rh_matches(&t->slots[idx], key, hash, cmp)) {
+            *created = 0;
+            return &t->slots[idx].value;
+        }
+        idx = (idx + 1) & mask;
+        dist++;
+    }
+
+    // the slot at idx is empty or closer to its home, either way the new
+    // entry is placed there and only the entries after it move on
+    struct rh_slot entry = { key, NULL, hash, dist };
+    _rh_place(t, entry, idx);
+    t->size++;
+    *created = 1;
+    return &t->slots[idx].value;
+}
+
+/*
+ * This function inserts a key/value pair into a table.  If an entry with
+ * the same key already exists its value is replaced.  The table is doubled
+ * before the insertion would push the load factor past 0.75.
+ *
+ * Params:
+ *   t - the table into which to insert.  May not be NULL.
+ *   key - the key of the entry.
+ *   value - the value to be stored.
+ *   hash - the hash code of `key`.
+ *   cmp - compares two keys and returns 0 when they are equal, or NULL if
+ *     equal hash codes mean equal keys.
+ */
+void rh_insert(struct rh_table* t, void* key, void* value, unsigned int hash,
+        int (*cmp)(void* a, void* b)) {
+    int created;
+    *rh_upsert(t, key, hash, cmp, &created) = value;
+}
+
+/*
+ * Auxilliary function that returns the slot index holding `key`, or -1 if
+ * no such entry exists.
+ */
+static int _rh_find(struct rh_table* t, void* key, unsigned int hash,
+        int (*cmp)(void* a, void* b)) {
+    int mask = t->capacity - 1;
+    int idx = rh_home(t, hash);
+    unsigned int dist = 1;
+
+    while (t->slots[idx].dist >= dist) {
+        if (_rh_matches(&t->slots[idx], key, hash, cmp)) {
+            return idx;
+        }
+        idx = (idx + 1) & mask;
+        dist++;
+    }
+    return -1;
+}
+
+/*
+ * This function returns the value stored under a key, or NULL if the key is
+ * not in the table.
+ *
+ * Params:
+ *   t - the table to search.  May not be NULL.
+ *   key - the key to search for.
+ *   hash - the hash code of `key`.
+ *   cmp - compares two keys and returns 0 when they are equal, or NULL if
+ *     equal hash codes mean equal keys.
+ */
+void* rh_lookup(struct rh_table* t, void* key, unsigned int hash,
+        int (*cmp)(void* a, void* b)) {
+    assert(t);
+    int idx = _rh_find(t, key, hash, cmp);
+    return idx < 0 ? NULL : t->slots[idx].value;
+}
+
+/*
+ * This function returns the number of slots a lookup of a key examines,
+ * whether or not the key is found.  It walks the same slots as
+ * rh_lookup() and is only meant for statistics.
+ *
+ * Params:
+ *   t - the table to search.  May not be NULL.
+ *   key - the key to search for.
+ *   hash - the hash code of `key`.
+ *   cmp - compares two keys and returns 0 when they are equal, or NULL if
+ *     equal hash codes mean equal keys.
+ */
+int rh_probes(struct rh_table* t, void* key, unsigned int hash,
+        int (*cmp)(void* a, void* b)) {
+    assert(t);
+    int mask = t->capacity - 1;
+    int idx = rh_home(t, hash);
+    unsigned int dist = 1;
+
+    while (t->slots[idx].dist >= dist && !_rh_matches(&t->slots[idx], key, hash, cmp)) {
+        idx = (idx + 1) & mask;
+        dist++;
+    }
+    return (int)dist;
+}
+
+/*
+ * This function removes the entry stored under a key, if any.  Instead of
+ * leaving a tombstone, every following entry that is not in its home slot is
+ * shifted back by one, so lookups never have to skip over deleted slots.
+ * Once the load factor drops below 1/8 the table is halved, down to the size
+ * it was created or reserved with.
+ *
+ * Params:
+ *   t - the table from which to remove.  May not be NULL.
+ *   key - the key to remove.
+ *   hash - the hash code of `key`.
+ *   cmp - compares two keys and returns 0 when they are equal, or NULL if
+ *     equal hash codes mean equal keys.
+ */
+void rh_remove(struct rh_table* t, void* key, unsigned int hash,
+        int (*cmp)(void* a, void* b)) {
+    assert(t);
+    int idx = _rh_find(t, key, hash, cmp);
+    if (idx < 0) {
+        return;
+    }
+
+    int mask = t->capacity - 1;
+    int next = (idx + 1) & mask;
+    while (t->slots[next].dist > 1) {
+        t->slots[idx] = t->slots[next];
+        t->slots[idx].dist--;
+        idx = next;
+        next = (next + 1) & mask;
+    }
+    t->slots[idx].dist = 0;
+    t->size--;
+
+    if (t->size * 8 < t->capacity && t->capacity > t->min_capacity) {
+        _rh_resize(t, t->capacity / 2);
+    }
+}
@@ -0,0 +1,43 @@
+/*
+ * This file contains the definition of the interface for an open-addressing
+ * table that uses Robin Hood linear probing.  It is the flat storage engine
+ * behind hash tables created with HT_ROBIN_HOOD.  You can find descriptions
+ * of the functions, including their parameters and their return values, in
+ * robin_hood.c.
+ */
+
+#ifndef __ROBIN_HOOD_H
+#define __ROBIN_HOOD_H
+
+/*
+ * Structure used to represent a Robin Hood table.
+ */
+struct rh_table;
+
+/*
+ * Robin Hood table interface function prototypes.  Refer to robin_hood.c for
+ * documentation about each of these functions.
+ */
+struct rh_table* rh_create();
+void rh_free(struct rh_table* t);
+int rh_size(struct rh_table* t);
+int rh_capacity(struct rh_table* t);
+int rh_home(struct rh_table* t, unsigned int hash);
+void rh_prefetch(struct rh_table* t, unsigned int hash);
+int rh_slot_get(struct rh_table* t, int idx, void** key, void** value, unsigned int* hash);
+int rh_scan_home(struct rh_table* t, int home, void (*fn)(void* arg, void* key, void* value),
+        void* arg);
+void rh_grow(struct rh_table* t);
+void rh_reserve(struct rh_table* t, int n);
+void** rh_upsert(struct rh_table* t, void* key, unsigned int hash,
+        int (*cmp)(void* a, void* b), int* created);
+void rh_insert(struct rh_table* t, void* key, void* value, unsigned int hash,
+        int (*cmp)(void* a, void* b));
+void* rh_lookup(struct rh_table* t, void* key, unsigned int hash,
+        int (*cmp)(void* a, void* b));
+int rh_probes(struct rh_table* t, void* key, unsigned int hash,
+        int (*cmp)(void* a, void* b));
+void rh_remove(struct rh_table* t, void* key, unsigned int hash,
+        int (*cmp)(void* a, void* b));
+
+#endif
@@ -0,0 +1,352 @@
+/*
+ * This file contains the on-disk format of hash table snapshots.  A snapshot
+ * holds no pointers, only offsets, so it can be mapped at any address and
+ * searched right away.  The file is laid out as follows:
+ *
+ *   header      magic, format version, hash seed, bucket count, value size
+ *               and entry count (struct snap_header)
+ *   offsets     num_buckets + 1 32-bit indices.  The entries of bucket b
+ *               are entries offsets[b] up to offsets[b + 1] - 1.
+ *   hashes      the 32-bit hash code of every entry, grouped by bucket
+ *   values      value_size bytes for every entry, in the same order,
+ *               starting at an 8-byte aligned offset
+ *
+ * Integers are stored in the byte order of the machine that wrote the file.
+ * See the documentation below for more information on the individual
+ * functions in this implementation.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "snapshot.h"
+
+/*
+ * Every snapshot starts with SNAP_MAGIC.  SNAP_VERSION is bumped whenever the
+ * layout, the way keys are mixed into the stored hash codes, or the way hash
+ * codes are mapped to buckets changes, since lookups on an older file would
+ * otherwise hash keys differently and silently miss.
+ */
+#define SNAP_MAGIC "HTSNAP\0"
+#define SNAP_VERSION 3
+
+/*
+ * This structure is the header at the start of every snapshot file.
+ */
+struct snap_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t seed;
+    uint32_t num_buckets;
+    uint32_t value_size;
+    uint64_t count;
+};
+
+/*
+ * This structure represents an open snapshot.  The pointers all point into
+ * the read-only mapping of the file.
+ */
+struct snapshot {
+    void* map;
+    size_t map_len;
+    const struct snap_header* header;
+    const uint32_t* offsets;
+    const uint32_t* hashes;
+    const char* values;
+};
+
+/*
+ * Auxilliary function that maps a hash code to a bucket of a snapshot.  The
+ * bucket count is a power of two and hash codes are stored mixed, so the low
+ * bits pick the bucket.
+ */
+static uint32_t _snap_bucket(uint32_t hash, uint32_t num_buckets) {
+    return hash & (num_buckets - 1);
+}
+
+/*
+ * Auxilliary function that returns the byte offset of the value region of a
+ * snapshot with the given bucket and entry counts.
+ */
+static size_t _snap_values_at(uint32_t num_buckets, uint64_t count) {
+    size_t at = sizeof(struct snap_header) + ((size_t)num_buckets + 1) * sizeof(uint32_t)
+        + count * sizeof(uint32_t);
+    return (at + 7) & ~(size_t)7;
+}
+
+/*
+ * Auxilliary function that checks the bucket offsets of a snapshot being
+ * opened.  They have to start at 0, never decrease and end at the entry
+ * count, or lookups on a corrupted file would read past the hash codes and
+ * values.
+ */
+static int _snap_offsets_valid(const uint32_t* offsets, uint32_t num_buckets,
+        uint64_t count) {
+    if (offsets[0] != 0 || offsets[num_buckets] != count) {
+        return 0;
+    }
+    for (uint32_t b = 0; b < num_buckets; b++) {
+        if (offsets[b] > offsets[b + 1]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * This function writes a snapshot holding `count` entries to a file.  The
+ * bucket count is the smallest power of two not below the entry count, so a
+ * snapshot has between half and one entry per bucket no matter how full the
+ * table it came from was.
+ *
+ * Params:
+ *   path - the file to write.  An existing file is replaced.
+ *   hashes - the hash code of every entry.
+ *   values - a pointer to the value of every entry.  `value_size` bytes are
+ *     copied from each of them.
+ *   count - the number of entries.
+ *   value_size - the number of bytes stored for every value.
+ *   seed - the hash seed recorded in the header.
+ *
+ * Return:
+ *   This function returns 0 on success and -1 if the file could not be
+ *   written.
+ */
+int snap_write(const char* path, unsigned int* hashes, void** values, int count,
+        size_t value_size, unsigned int seed) {
+    assert(path && count >= 0);
+    struct snap_header header;
+    uint32_t num_buckets = 1;
+    while (num_buckets < (uint32_t)count) {
+        num_buckets *= 2;
+    }
+    uint32_t* offsets = calloc(num_buckets + 1, sizeof(uint32_t));
+    uint32_t* order = malloc((count > 0 ? count : 1) * sizeof(uint32_t));
+    uint32_t* sorted = malloc((count > 0 ? count : 1) * sizeof(uint32_t));
+    assert(offsets && order && sorted);
+
+    /*
+     * Counting sort of the entries by bucket: count every bucket, turn the
+     * counts into start offsets, then drop every entry into its place.
+     * Placing an entry advances its bucket's offset, so afterwards offsets[b]
+     * is where bucket b + 1 starts and the offsets are shifted back by one.
+     */
+    for (int i = 0; i < count; i++) {
+        offsets[_snap_bucket(hashes[i], num_buckets) + 1]++;
+    }
+    for (uint32_t b = 0; b < num_buckets; b++) {
+        offsets[b + 1] += offsets[b];
+    }
+    for (int i = 0; i < count; i++) {
+        order[offsets[_snap_bucket(hashes[i], num_buckets)]++] = i;
+    }
+    for (uint32_t b = num_buckets; b > 0; b--) {
+        offsets[b] = offsets[b - 1];
+    }
+    offsets[0] = 0;
+    for (int i = 0; i < count; i++) {
+        sorted[i] = hashes[order[i]];
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAP_MAGIC, sizeof(header.magic));
+    header.version = SNAP_VERSION;
+    header.seed = seed;
+    header.num_buckets = num_buckets;
+    header.value_size = (uint32_t)value_size;
+    header.count = count;
+
+    int ok = 0;
+    FILE* f = fopen(path, "wb");
+    if (f) {
+        static const char pad[8];
+        size_t at = sizeof(header) + ((size_t)num_buckets + 1) * sizeof(uint32_t)
+            + count * sizeof(uint32_t);
+        ok = fwrite(&header, sizeof(header), 1, f) == 1
+            && fwrite(offsets, sizeof(uint32_t), num_buckets + 1, f) == num_buckets + 1
+            && fwrite(sorted, sizeof(uint32_t), count, f) == (size_t)count
+            && fwrite(pad, 1, _snap_values_at(num_buckets, count) - at, f)
+                == _snap_values_at(num_buckets, count) - at;
+        for (int i = 0; ok && i < count; i++) {
+            ok = fwrite(values[order[i]], 1, value_size, f) == value_size;
+        }
+        ok = (fclose(f) == 0) && ok;
+    }
+
+    free(offsets);
+    free(order);
+    free(sorted);
+    return ok ? 0 : -1;
+}
+
+/*
+ * This function maps a snapshot file read-only and returns a handle to it.
+ * Nothing is copied or rebuilt.  Opening reads the bucket offsets once to
+ * check them, a linear scan of 4 bytes per bucket, but never the hash codes
+ * or values, whose pages are read in by the first lookups that touch them.
+ *
+ * Params:
+ *   path - the snapshot file to open.
+ *
+ * Return:
+ *   This function returns the open snapshot, or NULL if the file could not
+ *   be mapped, is not a snapshot of this version, or its bucket offsets are
+ *   corrupted.
+ */
+struct snapshot* snap_open(const char* path) {
+    assert(path);
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(struct snap_header)) {
+        close(fd);
+        return NULL;
+    }
+    void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return NULL;
+    }
+
+    const struct snap_header* header = map;
+    if (memcmp(header->magic, SNAP_MAGIC, sizeof(header->magic)) != 0
+            || header->version != SNAP_VERSION || header->num_buckets == 0
+            || (header->num_buckets & (header->num_buckets - 1)) != 0
+            || header->count > UINT32_MAX
+            || _snap_values_at(header->num_buckets, header->count)
+                + header->count * header->value_size != (size_t)st.st_size
+            || !_snap_offsets_valid((const uint32_t*)(header + 1),
+                header->num_buckets, header->count)) {
+        munmap(map, st.st_size);
+        return NULL;
+    }
+
+    struct snapshot* s = malloc(sizeof(struct snapshot));
+    assert(s);
+    s->map = map;
+    s->map_len = st.st_size;
+    s->header = header;
+    s->offsets = (const uint32_t*)(header + 1);
+    s->hashes = s->offsets + header->num_buckets + 1;
+    s->values = (const char*)map + _snap_values_at(header->num_buckets, header->count);
+    return s;
+}
+
+/*
+ * This function unmaps a snapshot.  Values returned by snap_lookup() become
+ * invalid.
+ *
+ * Params:
+ *   s - the snapshot to close.  May not be NULL.
+ */
+void snap_close(struct snapshot* s) {
+    assert(s);
+    munmap(s->map, s->map_len);
+    free(s);
+}
+
+/*
+ * This function returns the number of entries stored in a snapshot.
+ */
+int snap_size(struct snapshot* s) {
+    assert(s);
+    return (int)s->header->count;
+}
+
+/*
+ * This function returns the hash seed recorded when the snapshot was
+ * written.
+ */
+unsigned int snap_seed(struct snapshot* s) {
+    assert(s);
+    return s->header->seed;
+}
+
+/*
+ * This function returns the number of buckets of a snapshot.
+ */
+int snap_num_buckets(struct snapshot* s) {
+    assert(s);
+    return (int)s->header->num_buckets;
+}
+
+/*
+ * This function returns the bucket of a snapshot that a hash code maps to.
+ *
+ * Params:
+ *   s - the snapshot.  May not be NULL.
+ *   hash - the hash code of the key.
+ */
+int snap_home(struct snapshot* s, unsigned int hash) {
+    return (int)_snap_bucket(hash, s->header->num_buckets);
+}
+
+/*
+ * This function asks the CPU to start loading the bucket offsets of a hash
+ * code, so a lookup that follows shortly after does not wait for memory.
+ *
+ * Params:
+ *   s - the snapshot that will be searched.  May not be NULL.
+ *   hash - the hash code of the key.
+ */
+void snap_prefetch(struct snapshot* s, unsigned int hash) {
+    __builtin_prefetch(s->offsets + snap_home(s, hash));
+}
+
+/*
+ * This function returns a pointer to the value stored under a hash code, or
+ * NULL if no entry has that hash code.  The pointer points into the mapped
+ * file and must not be written through.  Keys are not stored in snapshots,
+ * so entries are told apart by their hash codes alone.
+ *
+ * Params:
+ *   s - the snapshot to search.  May not be NULL.
+ *   hash - the hash code of the key.
+ */
+void* snap_lookup(struct snapshot* s, unsigned int hash) {
+    assert(s);
+    uint32_t b = _snap_bucket(hash, s->header->num_buckets);
+    for (uint32_t i = s->offsets[b]; i < s->offsets[b + 1]; i++) {
+        if (s->hashes[i] == hash) {
+            return (void*)(s->values + (size_t)i * s->header->value_size);
+        }
+    }
+    return NULL;
+}
+
+/*
+ * This function returns the number of hash codes a lookup compares, whether
+ * or not the hash code is found.  It is only meant for statistics.
+ *
+ * Params:
+ *   s - the snapshot to search.  May not be NULL.
+ *   hash - the hash code of the key.
+ */
+int snap_probes(struct snapshot* s, unsigned int hash) {
+    assert(s);
+    uint32_t b = _snap_bucket(hash, s->header->num_buckets);
+    uint32_t i = s->offsets[b];
+    while (i < s->offsets[b + 1] && s->hashes[i] != hash) {
+        i++;
+    }
+    return (int)(i - s->offsets[b]) + (i < s->offsets[b + 1]);
+}
+
+/*
+ * This function returns the number of entries in bucket `b` of a snapshot.
+ */
+int snap_bucket_size(struct snapshot* s, int b) {
+    assert(s && b >= 0 && (uint32_t)b < s->header->num_buckets);
+    return (int)(s->offsets[b + 1] - s->offsets[b]);
+}
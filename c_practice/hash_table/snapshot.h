@@ -0,0 +1,37 @@
+/*
+ * This file contains the definition of the interface for read-only hash
+ * table snapshots.  A snapshot is a file that can be mapped into memory and
+ * searched in place, without being loaded entry by entry.  It is the storage
+ * engine behind hash tables opened with ht_open_mapped().  You can find
+ * descriptions of the functions, including their parameters and their return
+ * values, in snapshot.c.
+ */
+
+#ifndef __SNAPSHOT_H
+#define __SNAPSHOT_H
+
+#include <stddef.h>
+
+/*
+ * Structure used to represent a mapped snapshot.
+ */
+struct snapshot;
+
+/*
+ * Snapshot interface function prototypes.  Refer to snapshot.c for
+ * documentation about each of these functions.
+ */
+int snap_write(const char* path, unsigned int* hashes, void** values, int count,
+        size_t value_size, unsigned int seed);
+struct snapshot* snap_open(const char* path);
+void snap_close(struct snapshot* s);
+int snap_size(struct snapshot* s);
+unsigned int snap_seed(struct snapshot* s);
+int snap_num_buckets(struct snapshot* s);
+int snap_home(struct snapshot* s, unsigned int hash);
+void snap_prefetch(struct snapshot* s, unsigned int hash);
+void* snap_lookup(struct snapshot* s, unsigned int hash);
+int snap_probes(struct snapshot* s, unsigned int hash);
+int snap_bucket_size(struct snapshot* s, int b);
+
+#endif
@@ -0,0 +1,285 @@
+/*
+ * This file contains a hash map keyed by byte strings.  Every distinct key is
+ * copied once into an arena of large chunks, next to a small header with the
+ * key's length and its hash code from hash_bytes().  The hash table
+ * underneath stores pointers to these records.  Keys are told apart by their
+ * hash code and length first, so memcmp() only runs on keys that are almost
+ * certainly equal.  Because each key is stored once, the copy returned by
+ * strmap_intern() can stand in for the string: equal strings get the same
+ * pointer.  See the documentation below for more information on the
+ * individual functions in this implementation.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <time.h>
+#include <assert.h>
+
+#include "hashers.h"
+#include "strmap.h"
+
+/*
+ * Number of bytes requested from malloc for every arena chunk.  Longer keys
+ * get a chunk of their own.
+ */
+#define STRMAP_CHUNK_BYTES (1 << 16)
+
+/*
+ * This structure represents a key, either stored in the arena or built on
+ * the stack to look a key up.  In the arena `bytes` points at a
+ * NUL-terminated copy of the key, usually right behind the record.
+ */
+struct sm_key {
+    unsigned int hash;
+    unsigned int len;
+    const char* bytes;
+    void* value;
+};
+
+/*
+ * This structure is the header at the start of every arena chunk.  Chunks
+ * are kept in a singly-linked list, newest first, so they can all be freed
+ * together.  Records are carved out of `data` one after the other.
+ */
+struct sm_chunk {
+    struct sm_chunk* next;
+    size_t size;
+    size_t used;
+    char data[];
+};
+
+/*
+ * This structure represents the whole map.  The table maps every record to
+ * itself, so a lookup returns the stored record.
+ */
+struct strmap {
+    struct ht* table;
+    struct sm_chunk* chunks;
+    size_t arena_bytes;
+    unsigned long long seed;
+};
+
+/*
+ * Auxilliary functions that the table uses to hash and compare records.
+ * The hash code and the length are compared before the bytes are.
+ */
+static int _sm_convert(void* key) {
+    return (int)((struct sm_key*)key)->hash;
+}
+
+static int _sm_cmp(void* a, void* b) {
+    struct sm_key* x = a;
+    struct sm_key* y = b;
+    if (x->hash != y->hash || x->len != y->len) {
+        return 1;
+    }
+    return memcmp(x->bytes, y->bytes, x->len);
+}
+
+/*
+ * Auxilliary function that carves `size` bytes, aligned for a record, out
+ * of the arena.
+ */
+static void* _sm_alloc(struct strmap* m, size_t size) {
+    size = (size + sizeof(void*) - 1) / sizeof(void*) * sizeof(void*);
+    struct sm_chunk* c = m->chunks;
+    if (c == NULL || c->size - c->used < size) {
+        size_t data = size > STRMAP_CHUNK_BYTES ? size : STRMAP_CHUNK_BYTES;
+        c = malloc(sizeof(struct sm_chunk) + data);
+        assert(c);
+        c->size = data;
+        c->used = 0;
+        if (size > STRMAP_CHUNK_BYTES && m->chunks) {
+            // an oversized key goes behind the current chunk, which still
+            // has room for the keys that follow
+            c->next = m->chunks->next;
+            m->chunks->next = c;
+        } else {
+            c->next = m->chunks;
+            m->chunks = c;
+        }
+        m->arena_bytes += sizeof(struct sm_chunk) + data;
+    }
+    void* p = c->data + c->used;
+    c->used += size;
+    return p;
+}
+
+/*
+ * Auxilliary function that fills in a record on the stack for looking up a
+ * key that is not copied.
+ */
+static void _sm_probe(struct strmap* m, struct sm_key* probe, const char* key, size_t len) {
+    if (len == 0) {
+        key = "";
+    }
+    unsigned long long h = hash_bytes(key, len, m->seed);
+    assert(len <= UINT_MAX);
+    probe->hash = (unsigned int)(h ^ (h >> 32));
+    probe->len = (unsigned int)len;
+    probe->bytes = key;
+    probe->value = NULL;
+}
+
+/*
+ * This function allocates and initializes a new, empty map and returns a
+ * pointer to it.  No arena chunk is allocated until the first key is added.
+ *
+ * Params:
+ *   type - the storage engine of the table underneath.  May not be
+ *     HT_MAPPED.
+ */
+struct strmap* strmap_create(enum ht_type type) {
+    assert(type != HT_MAPPED);
+    struct strmap* m = malloc(sizeof(struct strmap));
+    assert(m);
+    m->table = ht_create_type(type);
+    ht_set_key_cmp(m->table, _sm_cmp);
+    m->chunks = NULL;
+    m->arena_bytes = 0;
+    m->seed = hash_mix64((unsigned long long)time(NULL) ^ (unsigned long long)(uintptr_t)m);
+    return m;
+}
+
+/*
+ * This function frees the memory associated with a map, including every key
+ * copied into it.  Values are owned by the caller and are not freed.
+ *
+ * Params:
+ *   m - the map to be destroyed.  May not be NULL.
+ */
+void strmap_free(struct strmap* m) {
+    assert(m);
+    ht_free(m->table);
+    while (m->chunks) {
+        struct sm_chunk* next = m->chunks->next;
+        free(m->chunks);
+        m->chunks = next;
+    }
+    free(m);
+}
+
+/*
+ * Auxilliary functions that ht_upsert() calls from _sm_intern().  A new
+ * record still points at the caller's bytes, which are copied into the
+ * arena now that the record is in the table.  A record already in the
+ * table stays as it is.
+ */
+static void* _sm_init(void* key, void* arg) {
+    struct sm_key* rec = key;
+    char* bytes = _sm_alloc(arg, rec->len + 1);
+    memcpy(bytes, rec->bytes, rec->len);
+    bytes[rec->len] = '\0';
+    rec->bytes = bytes;
+    return rec;
+}
+
+static void* _sm_keep(void* value, void* arg) {
+    return value;
+}
+
+/*
+ * Auxilliary function that returns the record of a key, copying the key into
+ * the arena and adding it to the table with a NULL value if it is new.  The
+ * record is carved out of the arena before the table is probed, so a new key
+ * is added by the same probe that looks for it.  If the key is found instead,
+ * the record was the last thing carved out and is handed back.
+ */
+static struct sm_key* _sm_intern(struct strmap* m, const char* key, size_t len) {
+    struct sm_key* rec = _sm_alloc(m, sizeof(struct sm_key));
+    _sm_probe(m, rec, key, len);
+    struct sm_key* found = ht_upsert(m->table, rec, _sm_convert, _sm_init, _sm_keep, m);
+    if (found != rec) {
+        m->chunks->used -= sizeof(struct sm_key);
+    }
+    return found;
+}
+
+/*
+ * This function stores a value under a key.  If the key is already in the
+ * map its value is replaced, otherwise the key is copied into the map.
+ *
+ * Params:
+ *   m - the map into which to insert.  May not be NULL.
+ *   key - the bytes of the key.  They may contain NUL bytes and need not be
+ *     NUL-terminated.
+ *   len - the number of bytes of the key.
+ *   value - the value to be stored.
+ *
+ * Return:
+ *   This function returns the map's copy of the key, see strmap_intern().
+ */
+const char* strmap_put(struct strmap* m, const char* key, size_t len, void* value) {
+    assert(m && (key || len == 0));
+    struct sm_key* rec = _sm_intern(m, key, len);
+    rec->value = value;
+    return rec->bytes;
+}
+
+/*
+ * This function returns the value stored under a key, or NULL if the key is
+ * not in the map.  A key added with strmap_intern() only has a NULL value.
+ *
+ * Params:
+ *   m - the map to search.  May not be NULL.
+ *   key, len - the bytes of the key and their number.
+ */
+void* strmap_get(struct strmap* m, const char* key, size_t len) {
+    assert(m && (key || len == 0));
+    struct sm_key probe;
+    _sm_probe(m, &probe, key, len);
+    struct sm_key* rec = ht_lookup(m->table, &probe, _sm_convert);
+    return rec ? rec->value : NULL;
+}
+
+/*
+ * This function removes a key and its value from a map.  The arena does not
+ * free single keys, so the copy of the key stays valid, and takes up
+ * memory, until the map is freed.  Adding the key again makes a new copy.
+ *
+ * Params:
+ *   m - the map from which to remove.  May not be NULL.
+ *   key, len - the bytes of the key and their number.
+ */
+void strmap_remove(struct strmap* m, const char* key, size_t len) {
+    assert(m && (key || len == 0));
+    struct sm_key probe;
+    _sm_probe(m, &probe, key, len);
+    ht_remove(m->table, &probe, _sm_convert);
+}
+
+/*
+ * This function returns the map's copy of a key, adding the key with a NULL
+ * value if it is not in the map yet.  The copy is NUL-terminated and stays
+ * valid until the map is freed.  While a key stays in the map, interning
+ * equal strings returns the same pointer, so interned strings can be
+ * compared with == and stored by pointer elsewhere.
+ *
+ * Params:
+ *   m - the map holding the interned strings.  May not be NULL.
+ *   key, len - the bytes of the key and their number.
+ */
+const char* strmap_intern(struct strmap* m, const char* key, size_t len) {
+    assert(m && (key || len == 0));
+    return _sm_intern(m, key, len)->bytes;
+}
+
+/*
+ * This function returns the number of keys in a map, interned keys
+ * included.
+ */
+int strmap_size(struct strmap* m) {
+    assert(m);
+    return ht_size(m->table);
+}
+
+/*
+ * This function returns the number of bytes the arena has taken from
+ * malloc for keys, headers of the key records included.
+ */
+size_t strmap_arena_bytes(struct strmap* m) {
+    assert(m);
+    return m->arena_bytes;
+}
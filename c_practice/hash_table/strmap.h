@@ -0,0 +1,33 @@
+/*
+ * This file contains the definition of the interface for a hash map keyed by
+ * byte strings.  Keys are copied into the map and every distinct key is
+ * stored once.  You can find descriptions of the map functions, including
+ * their parameters and their return values, in strmap.c.
+ */
+
+#ifndef __STRMAP_H
+#define __STRMAP_H
+
+#include <stddef.h>
+
+#include "hash_table.h"
+
+/*
+ * Structure used to represent a string map.
+ */
+struct strmap;
+
+/*
+ * String map interface function prototypes.  Refer to strmap.c for
+ * documentation about each of these functions.
+ */
+struct strmap* strmap_create(enum ht_type type);
+void strmap_free(struct strmap* m);
+const char* strmap_put(struct strmap* m, const char* key, size_t len, void* value);
+void* strmap_get(struct strmap* m, const char* key, size_t len);
+void strmap_remove(struct strmap* m, const char* key, size_t len);
+const char* strmap_intern(struct strmap* m, const char* key, size_t len);
+int strmap_size(struct strmap* m);
+size_t strmap_arena_bytes(struct strmap* m);
+
+#endif
@@ -0,0 +1,521 @@
+/*
+ * This file contains an open-addressing table in the style of a "Swiss
+ * table".  Next to the array of entries it keeps one control byte per slot.
+ * A full slot's control byte holds 7 bits of the key's hash code, while empty
+ * and deleted slots use byte values with the high bit set.  A probe loads 16
+ * control bytes at once and compares them against the 7 hash bits with a
+ * single SSE2 instruction, so the entry array is only touched for slots whose
+ * control byte already matched.  See the documentation below for more
+ * information on the individual functions in this implementation.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "swiss_table.h"
+
+/*
+ * Slots are probed in aligned groups of SW_GROUP.  The table never lets more
+ * than 7/8 of its slots be used up by full or deleted entries.
+ */
+#define SW_GROUP 16
+#define SW_INIT_CAPACITY 16
+#define SW_EMPTY ((signed char)-128)
+#define SW_DELETED ((signed char)-2)
+
+/*
+ * This structure represents a single entry of the table.  The full hash
+ * code is kept so that entries can be moved on a resize and so keys can be
+ * rejected without calling the user's compare function.
+ */
+struct sw_slot {
+    void* key;
+    void* value;
+    unsigned int hash;
+};
+
+/*
+ * This structure represents the whole table.  `ctrl` holds one control byte
+ * per slot.  `growth_left` counts how many empty slots can still be filled
+ * before the table has to be rehashed.  The table never shrinks below
+ * `min_capacity`.
+ */
+struct sw_table {
+    signed char* ctrl;
+    struct sw_slot* slots;
+    int capacity;
+    int size;
+    int growth_left;
+    int min_capacity;
+};
+
+/*
+ * Auxilliary functions that split a hash code into the part used to pick the
+ * first group (h1) and the 7 bits stored in the control byte (h2).  Both are
+ * taken from the same hash code, so it is expected to be mixed already.
+ */
+static unsigned int _sw_h1(unsigned int mixed) {
+    return mixed >> 7;
+}
+
+static signed char _sw_h2(unsigned int mixed) {
+    return (signed char)(mixed & 0x7f);
+}
+
+/*
+ * Auxilliary function that returns a bit mask with bit i set for every
+ * control byte of the group starting at `group` that equals `b`.
+ */
+static unsigned int _sw_match(const signed char* group, signed char b) {
+#ifdef __SSE2__
+    __m128i ctrl = _mm_loadu_si128((const __m128i*)group);
+    return (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(b)));
+#else
+    unsigned int mask = 0;
+    for (int i = 0; i < SW_GROUP; i++) {
+        if (group[i] == b) {
+            mask |= 1u << i;
+        }
+    }
+    return mask;
+#endif
+}
+
+/*
+ * Auxilliary function that returns a bit mask of the empty or deleted slots
+ * of a group.  Those are exactly the control bytes with the high bit set.
+ */
+static unsigned int _sw_match_free(const signed char* group) {
+#ifdef __SSE2__
+    __m128i ctrl = _mm_loadu_si128((const __m128i*)group);
+    return (unsigned int)_mm_movemask_epi8(ctrl);
+#else
+    unsigned int mask = 0;
+    for (int i = 0; i < SW_GROUP; i++) {
+        if (group[i] < 0) {
+            mask |= 1u << i;
+        }
+    }
+    return mask;
+#endif
+}
+
+/*
+ * Auxilliary function that allocates the control bytes and slots for a
+ * table of `capacity` slots, all of them empty.
+ */
+static void _sw_alloc(struct sw_table* t, int capacity) {
+    t->ctrl = malloc(capacity);
+    assert(t->ctrl);
+    memset(t->ctrl, SW_EMPTY, capacity);
+    t->slots = malloc(capacity * sizeof(struct sw_slot));
+    assert(t->slots);
+    t->capacity = capacity;
+    t->growth_left = capacity - capacity / 8 - t->size;
+}
+
+/*
+ * This function allocates and initializes a new, empty Swiss table and
+ * returns a pointer to it.
+ */
+struct sw_table* sw_create() {
+    struct sw_table* t = malloc(sizeof(struct sw_table));
+    assert(t);
+    t->size = 0;
+    t->min_capacity = SW_INIT_CAPACITY;
+    _sw_alloc(t, SW_INIT_CAPACITY);
+    return t;
+}
+
+/*
+ * This function frees the memory associated with a Swiss table.  Keys and
+ * values stored in the table are owned by the caller and are not freed.
+ *
+ * Params:
+ *   t - the table to be destroyed.  May not be NULL.
+ */
+void sw_free(struct sw_table* t) {
+    assert(t);
+    free(t->ctrl);
+    free(t->slots);
+    free(t);
+}
+
+/*
+ * This function returns the number of entries stored in a table.
+ */
+int sw_size(struct sw_table* t) {
+    assert(t);
+    return t->size;
+}
+
+/*
+ * This function returns the number of slots in a table.
+ */
+int sw_capacity(struct sw_table* t) {
+    assert(t);
+    return t->capacity;
+}
+
+/*
+ * This function returns the index of the first slot of the group where the
+ * probe for a hash code starts.
+ *
+ * Params:
+ *   t - the table whose slot is being computed.  May not be NULL.
+ *   hash - the hash code of the key.
+ */
+int sw_home(struct sw_table* t, unsigned int hash) {
+    int group_mask = t->capacity / SW_GROUP - 1;
+    return (int)(_sw_h1(hash) & group_mask) * SW_GROUP;
+}
+
+/*
+ * This function asks the CPU to start loading the first control byte group
+ * probed for a hash code, so a lookup that follows shortly after does not
+ * wait for memory.
+ *
+ * Params:
+ *   t - the table that will be probed.  May not be NULL.
+ *   hash - the hash code of the key.
+ */
+void sw_prefetch(struct sw_table* t, unsigned int hash) {
+    __builtin_prefetch(t->ctrl + sw_home(t, hash));
+}
+
+/*
+ * This function reads the entry stored in one slot of a table, so callers
+ * can visit every entry by walking the slots from 0 to the capacity.
+ *
+ * Params:
+ *   t - the table to read.  May not be NULL.
+ *   idx - the slot index, between 0 and the table's capacity.
+ *   key, value, hash - receive the entry stored in the slot, if any.
+ *
+ * Return:
+ *   This function returns 1 if the slot holds an entry and 0 if it is empty.
+ */
+int sw_slot_get(struct sw_table* t, int idx, void** key, void** value, unsigned int* hash) {
+    assert(t && idx >= 0 && idx < t->capacity);
+    if (t->ctrl[idx] < 0) {
+        return 0;
+    }
+    *key = t->slots[idx].key;
+    *value = t->slots[idx].value;
+    *hash = t->slots[idx].hash;
+    return 1;
+}
+
+/*
+ * This function returns the number of 16-slot groups of a table.
+ */
+int sw_num_groups(struct sw_table* t) {
+    assert(t);
+    return t->capacity / SW_GROUP;
+}
+
+/*
+ * This function visits every entry whose probe starts at a given group,
+ * wherever on its probe sequence the entry ended up.  It walks the groups
+ * a lookup starting there would walk, so it costs about as much as one
+ * lookup.  Together the groups 0 to sw_num_groups() - 1 visit every entry
+ * exactly once.
+ *
+ * Params:
+ *   t - the table to walk.  May not be NULL.
+ *   group - the index of the group, between 0 and sw_num_groups() - 1.
+ *   fn - called with `arg` and the key and value of every entry.
+ *   arg - passed through to `fn`.
+ *
+ * Return:
+ *   This function returns the number of entries visited.
+ */
+int sw_scan_group(struct sw_table* t, int group, void (*fn)(void* arg, void* key, void* value),
+        void* arg) {
+    assert(t);
+    int group_mask = t->capacity / SW_GROUP - 1;
+    int g = group;
+    int count = 0;
+
+    for (int i = 1; i <= group_mask + 1; i++) {
+        const signed char* ctrl = t->ctrl + g * SW_GROUP;
+        unsigned int full = ~_sw_match_free(ctrl) & 0xffff;
+        while (full) {
+            struct sw_slot* slot = &t->slots[g * SW_GROUP + __builtin_ctz(full)];
+            if ((int)(_sw_h1(slot->hash) & group_mask) == group) {
+                fn(arg, slot->key, slot->value);
+                count++;
+            }
+            full &= full - 1;
+        }
+        if (_sw_match(ctrl, SW_EMPTY)) {
+            break;
+        }
+        g = (g + i) & group_mask;
+    }
+    return count;
+}
+
+/*
+ * Auxilliary function that returns the index of the first empty or deleted
+ * slot on the probe sequence of a hash code.  Groups are visited in
+ * triangular order, which reaches every group when their count is a power of
+ * two.
+ */
+static int _sw_find_free(struct sw_table* t, unsigned int hash) {
+    int group_mask = t->capacity / SW_GROUP - 1;
+    int g = _sw_h1(hash) & group_mask;
+
+    for (int i = 1; ; i++) {
+        unsigned int free_mask = _sw_match_free(t->ctrl + g * SW_GROUP);
+        if (free_mask) {
+            return g * SW_GROUP + __builtin_ctz(free_mask);
+        }
+        g = (g + i) & group_mask;
+    }
+}
+
+/*
+ * Auxilliary function that returns the slot index holding `key`, or -1 if no
+ * such entry exists.  The probe stops at the first group that still has an
+ * empty slot, because an insert would never have continued past it.
+ */
+static int _sw_find(struct sw_table* t, void* key, unsigned int hash,
+        int (*cmp)(void* a, void* b)) {
+    signed char h2 = _sw_h2(hash);
+    int group_mask = t->capacity / SW_GROUP - 1;
+    int g = _sw_h1(hash) & group_mask;
+
+    for (int i = 1; i <= group_mask + 1; i++) {
+        const signed char* group = t->ctrl + g * SW_GROUP;
+        unsigned int match = _sw_match(group, h2);
+        while (match) {
+            int idx = g * SW_GROUP + __builtin_ctz(match);
+            struct sw_slot* slot = &t->slots[idx];
+            if (slot->hash == hash && (cmp == NULL || cmp(key, slot->key) == 0)) {
+                return idx;
+            }
+            match &= match - 1;
+        }
+        if (_sw_match(group, SW_EMPTY)) {
+            return -1;
+        }
+        g = (g + i) & group_mask;
+    }
+    return -1;
+}
+
+/*
+ * Auxilliary function that moves every entry into freshly allocated arrays of
+ * `capacity` slots.  Deleted slots are dropped along the way.
+ */
+static void _sw_rehash(struct sw_table* t, int capacity) {
+    signed char* old_ctrl = t->ctrl;
+    struct sw_slot* old_slots = t->slots;
+    int old_cap = t->capacity;
+
+    _sw_alloc(t, capacity);
+    for (int i = 0; i < old_cap; i++) {
+        if (old_ctrl[i] >= 0) {
+            int idx = _sw_find_free(t, old_slots[i].hash);
+            t->ctrl[idx] = _sw_h2(old_slots[i].hash);
+            t->slots[idx] = old_slots[i];
+        }
+    }
+    free(old_ctrl);
+    free(old_slots);
+}
+
+/*
+ * This function doubles the number of slots in a table.
+ *
+ * Params:
+ *   t - the table to grow.  May not be NULL.
+ */
+void sw_grow(struct sw_table* t) {
+    assert(t);
+    _sw_rehash(t, t->capacity * 2);
+}
+
+/*
+ * This function makes sure a table can hold `n` entries without being
+ * rehashed, and keeps it from shrinking below that size when entries are
+ * removed.
+ *
+ * Params:
+ *   t - the table to size.  May not be NULL.
+ *   n - the number of entries to make room for.
+ */
+void sw_reserve(struct sw_table* t, int n) {
+    assert(t && n >= 0);
+    int capacity = SW_INIT_CAPACITY;
+    while (n > capacity - capacity / 8) {
+        capacity *= 2;
+    }
+    t->min_capacity = capacity;
+    if (capacity > t->capacity) {
+        _sw_rehash(t, capacity);
+    }
+}
+
+/*
+ * This function finds the entry of a key, adding one with a NULL value if
+ * there is none, and returns where its value is stored, so the caller can
+ * read and update the value without a second lookup.  When no empty slot
+ * may be used up anymore the table is rehashed: it doubles if it is more
+ * than half of the way to its maximum load, otherwise it keeps its size and
+ * only drops deleted slots.
+ *
+ * Params:
+ *   t - the table to search and insert into.  May not be NULL.
+ *   key - the key of the entry.
+ *   hash - the hash code of `key`.
+ *   cmp - compares two keys and returns 0 when they are equal, or NULL if
+ *     equal hash codes mean equal keys.
+ *   created - set to 1 if the entry was added and to 0 if it existed.
+ *
+ * Return:
+ *   This function returns a pointer to the value of the entry.  It is only
+ *   valid until the table is changed again.
+ */
+void** sw_upsert(struct sw_table* t, void* key, unsigned int hash,
+        int (*cmp)(void* a, void* b), int* created) {
+    assert(t && created);
+    int idx = _sw_find(t, key, hash, cmp);
+    if (idx >= 0) {
+        *created = 0;
+        return &t->slots[idx].value;
+    }
+
+    if (t->growth_left == 0) {
+        int max_load = t->capacity - t->capacity / 8;
+        _sw_rehash(t, t->size * 2 >= max_load ? t->capacity * 2 : t->capacity);
+    }
+
+    idx = _sw_find_free(t, hash);
+    if (t->ctrl[idx] == SW_EMPTY) {
+        t->growth_left--;
+    }
+    t->ctrl[idx] = _sw_h2(hash);
+    t->slots[idx].key = key;
+    t->slots[idx].value = NULL;
+    t->slots[idx].hash = hash;
+    t->size++;
+    *created = 1;
+    return &t->slots[idx].value;
+}
+
+/*
+ * This function inserts a key/value pair into a table.  If an entry with the
+ * same key already exists its value is replaced.  See sw_upsert() for when
+ * the table is rehashed.
+ *
+ * Params:
+ *   t - the table into which to insert.  May not be NULL.
+ *   key - the key of the entry.
+ *   value - the value to be stored.
+ *   hash - the hash code of `key`.
+ *   cmp - compares two keys and returns 0 when they are equal, or NULL if
+ *     equal hash codes mean equal keys.
+ */
+void sw_insert(struct sw_table* t, void* key, void* value, unsigned int hash,
+        int (*cmp)(void* a, void* b)) {
+    int created;
+    *sw_upsert(t, key, hash, cmp, &created) = value;
+}
+
+/*
+ * This function returns the value stored under a key, or NULL if the key is
+ * not in the table.
+ *
+ * Params:
+ *   t - the table to search.  May not be NULL.
+ *   key - the key to search for.
+ *   hash - the hash code of `key`.
+ *   cmp - compares two keys and returns 0 when they are equal, or NULL if
+ *     equal hash codes mean equal keys.
+ */
+void* sw_lookup(struct sw_table* t, void* key, unsigned int hash,
+        int (*cmp)(void* a, void* b)) {
+    assert(t);
+    int idx = _sw_find(t, key, hash, cmp);
+    return idx < 0 ? NULL : t->slots[idx].value;
+}
+
+/*
+ * This function returns the number of 16-slot groups a lookup of a key
+ * examines, whether or not the key is found.  It walks the same groups as
+ * sw_lookup() and is only meant for statistics.
+ *
+ * Params:
+ *   t - the table to search.  May not be NULL.
+ *   key - the key to search for.
+ *   hash - the hash code of `key`.
+ *   cmp - compares two keys and returns 0 when they are equal, or NULL if
+ *     equal hash codes mean equal keys.
+ */
+int sw_probes(struct sw_table* t, void* key, unsigned int hash,
+        int (*cmp)(void* a, void* b)) {
+    assert(t);
+    signed char h2 = _sw_h2(hash);
+    int group_mask = t->capacity / SW_GROUP - 1;
+    int g = _sw_h1(hash) & group_mask;
+
+    for (int i = 1; i <= group_mask + 1; i++) {
+        const signed char* group = t->ctrl + g * SW_GROUP;
+        unsigned int match = _sw_match(group, h2);
+        while (match) {
+            struct sw_slot* slot = &t->slots[g * SW_GROUP + __builtin_ctz(match)];
+            if (slot->hash == hash && (cmp == NULL || cmp(key, slot->key) == 0)) {
+                return i;
+            }
+            match &= match - 1;
+        }
+        if (_sw_match(group, SW_EMPTY)) {
+            return i;
+        }
+        g = (g + i) & group_mask;
+    }
+    return group_mask + 1;
+}
+
+/*
+ * This function removes the entry stored under a key, if any.  The slot can
+ * go straight back to empty when its group still has an empty slot, since no
+ * probe ever went past such a group.  Otherwise it is marked deleted so that
+ * probes keep walking past it.  Once the load factor drops below 1/8 the
+ * table is halved, down to the size it was created or reserved with.
+ *
+ * Params:
+ *   t - the table from which to remove.  May not be NULL.
+ *   key - the key to remove.
+ *   hash - the hash code of `key`.
+ *   cmp - compares two keys and returns 0 when they are equal, or NULL if
+ *     equal hash codes mean equal keys.
+ */
+void sw_remove(struct sw_table* t, void* key, unsigned int hash,
+        int (*cmp)(void* a, void* b)) {
+    assert(t);
+    int idx = _sw_find(t, key, hash, cmp);
+    if (idx < 0) {
+        return;
+    }
+
+    const signed char* group = t->ctrl + (idx & ~(SW_GROUP - 1));
+    if (_sw_match(group, SW_EMPTY)) {
+        t->ctrl[idx] = SW_EMPTY;
+        t->growth_left++;
+    } else {
+        t->ctrl[idx] = SW_DELETED;
+    }
+    t->size--;
+
+    if (t->size * 8 < t->capacity && t->capacity > t->min_capacity) {
+        _sw_rehash(t, t->capacity / 2);
+    }
+}
@@ -0,0 +1,44 @@
+/*
+ * This file contains the definition of the interface for an open-addressing
+ * table that keeps one control byte per slot and probes 16 slots at a time
+ * (a "Swiss table").  It is the storage engine behind hash tables created
+ * with HT_SWISS.  You can find descriptions of the functions, including their
+ * parameters and their return values, in swiss_table.c.
+ */
+
+#ifndef __SWISS_TABLE_H
+#define __SWISS_TABLE_H
+
+/*
+ * Structure used to represent a Swiss table.
+ */
+struct sw_table;
+
+/*
+ * Swiss table interface function prototypes.  Refer to swiss_table.c for
+ * documentation about each of these functions.
+ */
+struct sw_table* sw_create();
+void sw_free(struct sw_table* t);
+int sw_size(struct sw_table* t);
+int sw_capacity(struct sw_table* t);
+int sw_home(struct sw_table* t, unsigned int hash);
+void sw_prefetch(struct sw_table* t, unsigned int hash);
+int sw_slot_get(struct sw_table* t, int idx, void** key, void** value, unsigned int* hash);
+int sw_num_groups(struct sw_table* t);
+int sw_scan_group(struct sw_table* t, int group, void (*fn)(void* arg, void* key, void* value),
+        void* arg);
+void sw_grow(struct sw_table* t);
+void sw_reserve(struct sw_table* t, int n);
+void** sw_upsert(struct sw_table* t, void* key, unsigned int hash,
+        int (*cmp)(void* a, void* b), int* created);
+void sw_insert(struct sw_table* t, void* key, void* value, unsigned int hash,
+        int (*cmp)(void* a, void* b));
+void* sw_lookup(struct sw_table* t, void* key, unsigned int hash,
+        int (*cmp)(void* a, void* b));
+int sw_probes(struct sw_table* t, void* key, unsigned int hash,
+        int (*cmp)(void* a, void* b));
+void sw_remove(struct sw_table* t, void* key, unsigned int hash,
+        int (*cmp)(void* a, void* b));
+
+#endif
@@ -0,0 +1,127 @@
+/*
+ * This is a small program to test the hash aggregation operator.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "agg.h"
+
+/*
+ * This is a convert function to be used to convert the integer key.  It
+ * counts its calls, every row should be converted once.
+ */
+long converts = 0;
+
+int convert_int(void* key){
+    int *k = key;
+    converts++;
+    return *k;
+}
+
+/*
+ * These functions sum the values of a group.  Rows pass their value as the
+ * argument and the sum is stored in the value pointer itself.
+ */
+void* sum_init(void* key, void* arg){
+    return arg;
+}
+
+void* sum_update(void* value, void* arg){
+    return (void*)((intptr_t)value + (intptr_t)arg);
+}
+
+/*
+ * This function checks every group of an aggregation: group g should hold
+ * the sum `expected[g]`.  It returns the number of wrong groups.
+ */
+int check_groups(struct agg* a, long* expected, int groups){
+    struct ht_entry batch[1024];
+    int wrong = 0, seen = 0, got;
+
+    for (int p = 0; p < agg_partitions(a); ++p){
+        unsigned int cursor = 0;
+        do {
+            got = ht_scan(agg_partition(a, p), &cursor, 1024, batch);
+            if (got < 0)
+                return -1;
+            for (int i = 0; i < got; ++i){
+                int g = *(int*)batch[i].key;
+                if (g < 0 || g >= groups || (intptr_t)batch[i].value != expected[g])
+                    wrong++;
+            }
+            seen += got;
+        } while (cursor != 0);
+    }
+    return wrong + (seen != groups);
+}
+
+int main(int argc, char** argv){
+    const int groups = 3000, rows = 100000;
+    enum ht_type types[] = {HT_CHAINING, HT_ROBIN_HOOD, HT_SWISS};
+    const char* names[] = {"chaining", "robin_hood", "swiss"};
+    int* keys = malloc(groups * sizeof(int));
+    long* expected = calloc(groups, sizeof(long));
+    void** row_keys = malloc(rows * sizeof(void*));
+    void** row_vals = malloc(rows * sizeof(void*));
+    int i, wrong;
+
+    /*
+     * Seed the random number generator with a constant value, so it produces the
+     * same sequence of pseudo-random values every time this program is run.
+     */
+    srand(0);
+    for (i = 0; i < groups; ++i)
+        keys[i] = i;
+    for (i = 0; i < rows; ++i){
+        int g = rand() % groups;
+        int v = rand() % 100;
+        row_keys[i] = &keys[g];
+        row_vals[i] = (void*)(intptr_t)v;
+        expected[g] += v;
+    }
+
+    for (int t = 0; t < 3; ++t){
+        /*
+         * Summing the rows one at a time into a single partition...
+         */
+        printf("\nAggregating into %s tables...\n", names[t]);
+        struct agg* a = agg_create(types[t], 1, convert_int, sum_init, sum_update);
+        converts = 0;
+        for (i = 0; i < rows; ++i)
+            agg_add(a, row_keys[i], row_vals[i]);
+        wrong = check_groups(a, expected, groups);
+        printf("wrong groups with 1 partition, should be 0: %d...", wrong);
+        if (wrong != 0 || agg_size(a) != groups || converts != rows)
+            printf("FAIL\n");
+        else
+            printf("OK\n");
+        agg_free(a);
+
+        /*
+         * Summing the rows in uneven batches over 16 partitions, every group
+         * should end up in exactly one partition...
+         */
+        a = agg_create(types[t], 16, convert_int, sum_init, sum_update);
+        converts = 0;
+        for (i = 0; i < rows; i += 777)
+            agg_add_batch(a, row_keys + i, row_vals + i, rows - i < 777 ? rows - i : 777);
+        wrong = check_groups(a, expected, groups);
+        printf("wrong groups with %d partitions, should be 0: %d...", agg_partitions(a), wrong);
+        if (wrong != 0 || agg_size(a) != groups || converts != rows)
+            printf("FAIL\n");
+        else
+            printf("OK\n");
+        agg_free(a);
+    }
+
+    free(keys);
+    free(expected);
+    free(row_keys);
+    free(row_vals);
+
+    printf("\n\nCheck valgrind for memory leaks...\n");
+
+    return 0;
+}
@@ -0,0 +1,128 @@
+/*
+ * This is a small program that stress tests the concurrent hash table.
+ * Writer threads keep inserting and removing their own keys, which forces
+ * resizes and node reclamation, while reader threads check that keys nobody
+ * touches are always found with the right value.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "concurrent_ht.h"
+
+#define NUM_STABLE 20000
+#define NUM_WRITERS 4
+#define NUM_READERS 4
+#define KEYS_PER_WRITER 20000
+#define WRITER_ROUNDS 4
+
+struct cht* cht;
+int stable[NUM_STABLE];
+int churn[NUM_WRITERS][KEYS_PER_WRITER];
+int writers_done = 0;
+
+/*
+ * This is a convert function to be used to convert the integer key
+ */
+int convert_int(void* key){
+    int *k = key;
+    return *k;
+}
+
+/*
+ * Each writer inserts all of its keys, removes them again, and so on for
+ * WRITER_ROUNDS rounds, leaving its keys inserted at the end.
+ */
+void* writer(void* arg){
+    int* keys = arg;
+    for (int r = 0; r < WRITER_ROUNDS; r++){
+        for (int i = 0; i < KEYS_PER_WRITER; i++)
+            cht_insert(cht, &keys[i], &keys[i], convert_int);
+        if (r == WRITER_ROUNDS - 1)
+            break;
+        for (int i = 0; i < KEYS_PER_WRITER; i++)
+            cht_remove(cht, &keys[i], convert_int);
+    }
+    return NULL;
+}
+
+/*
+ * Each reader looks up stable keys, which must always be found, and churning
+ * keys, which may or may not be found but must never map to a wrong value.
+ * It returns the number of wrong answers it saw.
+ */
+void* reader(void* arg){
+    long errors = 0;
+    unsigned int seed = (unsigned int)(long)arg;
+    while (!__atomic_load_n(&writers_done, __ATOMIC_ACQUIRE)){
+        seed = seed * 1103515245u + 12345u;
+        int i = (seed >> 8) % NUM_STABLE;
+        int* v = cht_lookup(cht, &stable[i], convert_int);
+        if (v == NULL || *v != stable[i])
+            errors++;
+
+        int w = (seed >> 4) % NUM_WRITERS;
+        int j = (seed >> 8) % KEYS_PER_WRITER;
+        v = cht_lookup(cht, &churn[w][j], convert_int);
+        if (v != NULL && *v != churn[w][j])
+            errors++;
+    }
+    return (void*)errors;
+}
+
+int main(void){
+    pthread_t writers[NUM_WRITERS], readers[NUM_READERS];
+    long errors = 0;
+
+    cht = cht_create();
+    for (int i = 0; i < NUM_STABLE; i++){
+        stable[i] = i;
+        cht_insert(cht, &stable[i], &stable[i], convert_int);
+    }
+    for (int w = 0; w < NUM_WRITERS; w++)
+        for (int i = 0; i < KEYS_PER_WRITER; i++)
+            churn[w][i] = NUM_STABLE + w * KEYS_PER_WRITER + i;
+
+    printf("\nRunning %d writer and %d reader threads...\n", NUM_WRITERS, NUM_READERS);
+    for (int i = 0; i < NUM_READERS; i++)
+        pthread_create(&readers[i], NULL, reader, (void*)(long)(i + 1));
+    for (int w = 0; w < NUM_WRITERS; w++)
+        pthread_create(&writers[w], NULL, writer, churn[w]);
+
+    for (int w = 0; w < NUM_WRITERS; w++)
+        pthread_join(writers[w], NULL);
+    __atomic_store_n(&writers_done, 1, __ATOMIC_RELEASE);
+    for (int i = 0; i < NUM_READERS; i++){
+        void* ret;
+        pthread_join(readers[i], &ret);
+        errors += (long)ret;
+    }
+
+    printf("wrong lookups seen by readers, should be 0: %ld...", errors);
+    if (errors != 0)
+        printf("FAIL\n");
+    else
+        printf("OK\n");
+
+    int size = NUM_STABLE + NUM_WRITERS * KEYS_PER_WRITER;
+    printf("size should be %d: %d...", size, cht_size(cht));
+    if (cht_size(cht) != size)
+        printf("FAIL\n");
+    else
+        printf("OK\n");
+
+    int missing = 0;
+    for (int w = 0; w < NUM_WRITERS; w++)
+        for (int i = 0; i < KEYS_PER_WRITER; i++)
+            if (cht_lookup(cht, &churn[w][i], convert_int) != &churn[w][i])
+                missing++;
+    printf("writer keys missing after the run, should be 0: %d...", missing);
+    if (missing != 0)
+        printf("FAIL\n");
+    else
+        printf("OK\n");
+
+    cht_free(cht);
+    return 0;
+}
@@ -4,8 +4,11 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
 
 #include "hash_table.h"
+#include "hashers.h"
 
 /*
  * This is a convert function to be used to convert the integer key
@@ -15,6 +18,41 @@ int convert_int(void* key){
     return *k;
 }
 
+/*
+ * This is a deliberately weak convert function that maps many keys to the
+ * same hash code, used to check that colliding keys are told apart.
+ */
+int convert_mod(void* key){
+    int *k = key;
+    return *k % 4;
+}
+
+/*
+ * This function compares two integer keys, returning 0 if they are equal
+ */
+int cmp_int(void* a, void* b){
+    return *(int*)a - *(int*)b;
+}
+
+/*
+ * This function compares two string keys, returning 0 if they are equal
+ */
+int cmp_str(void* a, void* b){
+    return strcmp(a, b);
+}
+
+/*
+ * These functions count how often a key is upserted.  The count is stored
+ * in the value pointer itself.
+ */
+void* count_init(void* key, void* arg){
+    return (void*)(intptr_t)1;
+}
+
+void* count_update(void* value, void* arg){
+    return (void*)((intptr_t)value + 1);
+}
+
 /*
  * This function returns the number of distinct elements in a given array
  */
@@ -29,8 +67,9 @@ int distinct_element (int arr[], int size){
 	return count;
 }
 
-int main(void){
+int main(int argc, char** argv){
     struct ht *ht;
+    enum ht_type type = HT_CHAINING;
     int *elem_val;
     int i, j, k, key, value, size;
     const int n = 8, m = 8;
@@ -42,10 +81,19 @@ int main(void){
      */
     srand(0);
 
+    /*
+     * The storage engine under test can be picked on the command line, e.g.
+     * `./test_ht robin_hood`.  The chaining engine is tested by default.
+     */
+    if (argc > 1 && strcmp(argv[1], "robin_hood") == 0)
+        type = HT_ROBIN_HOOD;
+    else if (argc > 1 && strcmp(argv[1], "swiss") == 0)
+        type = HT_SWISS;
+
     /*
      * Create a hash table and check ht_create()
      */
-    ht = ht_create();
+    ht = ht_create_type(type);
     printf("\nChecking that hash table is not NULL... ");
     fflush(stdout);
     if (ht == NULL) 
@@ -214,6 +262,542 @@ int main(void){
     }
     printf("== Did we see all values we expected (expect 1)? %d\n", k == n);
 
+    ht_free(ht);
+
+    /*
+     * Insert keys that all share a handful of hash codes into a table with a
+     * key compare function, they should all be stored separately...
+     */
+    printf("\nInserting 16 keys that share 4 hash codes...\n");
+    ht = ht_create_type(type);
+    ht_set_key_cmp(ht, cmp_int);
+    for (i = 0; i < 16; ++i){
+        val1[i] = i;
+        ht_insert(ht, (void*)&val1[i], (void*)&val1[i], convert_mod);
+    }
+    printf("size should be 16: %d...", ht_size(ht));
+    if (ht_size(ht) != 16)
+        printf("FAIL\n");
+    else
+        printf("OK\n");
+
+    j = 0;
+    for (i = 0; i < 16; ++i){
+        elem_val = ht_lookup(ht, (void*)&val1[i], convert_mod);
+        if (elem_val == NULL || *elem_val != i)
+            j++;
+    }
+    printf("lookups returning the wrong value, should be 0: %d...", j);
+    if (j != 0)
+        printf("FAIL\n");
+    else
+        printf("OK\n");
+
+    for (i = 0; i < 16; i += 2){
+        ht_remove(ht, (void*)&val1[i], convert_mod);
+    }
+    k = 7;
+    elem_val = ht_lookup(ht, (void*)&k, convert_mod);
+    printf("after removing even keys, size should be 8: %d, key 7 found: %d...",
+        ht_size(ht), elem_val != NULL);
+    if (ht_size(ht) != 8 || elem_val == NULL)
+        printf("FAIL\n");
+    else
+        printf("OK\n");
+
+    ht_free(ht);
+
+    /*
+     * Insert and look up keys in batches, half of the looked up keys are not
+     * in the table...
+     */
+    printf("\nInserting and looking up 1000 keys in batches...\n");
+    ht = ht_create_type(type);
+    int* batch_vals = malloc(2000 * sizeof(int));
+    void** batch_keys = malloc(2000 * sizeof(void*));
+    void** batch_out = malloc(2000 * sizeof(void*));
+    for (i = 0; i < 2000; ++i){
+        batch_vals[i] = i * 7;
+        batch_keys[i] = &batch_vals[i];
+    }
+    ht_insert_batch(ht, batch_keys, batch_keys, 1000, convert_int);
+    printf("size should be 1000: %d...", ht_size(ht));
+    if (ht_size(ht) != 1000)
+        printf("FAIL\n");
+    else
+        printf("OK\n");
+
+    ht_lookup_batch(ht, batch_keys, 2000, convert_int, batch_out);
+    j = 0;
+    for (i = 0; i < 2000; ++i){
+        if (batch_out[i] != ht_lookup(ht, batch_keys[i], convert_int)
+                || (batch_out[i] != NULL) != (i < 1000))
+            j++;
+    }
+    printf("batch lookups disagreeing with ht_lookup, should be 0: %d...", j);
+    if (j != 0)
+        printf("FAIL\n");
+    else
+        printf("OK\n");
+
+
+    /*
+     * Save the table to a snapshot and map it back in, every value should be
+     * found again as a copy inside the mapping...
+     */
+    printf("\nSaving the table and mapping the snapshot back in...\n");
+    struct ht* mapped = NULL;
+    if (ht_save(ht, "test_ht.snap", sizeof(int)) == 0)
+        mapped = ht_open_mapped("test_ht.snap");
+    printf("mapped table should not be NULL, size should be 1000: %d...",
+        mapped ? ht_size(mapped) : -1);
+    if (mapped == NULL || ht_size(mapped) != 1000)
+        printf("FAIL\n");
+    else
+        printf("OK\n");
+
+    j = 0;
+    for (i = 0; mapped && i < 2000; ++i){
+        elem_val = ht_lookup(mapped, batch_keys[i], convert_int);
+        if (i < 1000 ? (elem_val == NULL || *elem_val != batch_vals[i]) : elem_val != NULL)
+            j++;
+    }
+    printf("wrong lookups in the mapped table, should be 0: %d...", j);
+    if (mapped == NULL || j != 0)
+        printf("FAIL\n");
+    else
+        printf("OK\n");
+    if (mapped)
+        ht_free(mapped);
+
+    /*
+     * A snapshot of the right size whose bucket offsets run past the entry
+     * count should be rejected instead of mapped...
+     */
+    FILE* snap = fopen("test_ht.snap", "r+b");
+    unsigned int bad_offset = 0xffffffffu;
+    mapped = NULL;
+    if (snap) {
+        fseek(snap, 32 + sizeof(unsigned int), SEEK_SET);
+        fwrite(&bad_offset, sizeof(bad_offset), 1, snap);
+        fclose(snap);
+        mapped = ht_open_mapped("test_ht.snap");
+    }
+    printf("snapshot with corrupted offsets should not open: %s...",
+        mapped ? "opened" : "rejected");
+    if (snap == NULL || mapped != NULL)
+        printf("FAIL\n");
+    else
+        printf("OK\n");
+    if (mapped)
+        ht_free(mapped);
+    remove("test_ht.snap");
+
+    free(batch_vals);
+    free(batch_keys);
+    free(batch_out);
+
+    /*
+     * Reserve room, fill the table with negative and positive keys past the
+     * reservation, then purge most of them so it shrinks again...
+     */
+    printf("\nInserting 20000 keys into a table reserved for 5000, removing 19990...\n");
+    ht_free(ht);
+    if (type == HT_CHAINING)
+        ht = ht_create_with_capacity(5000);
+    else {
+        ht = ht_create_type(type);
+        ht_reserve(ht, 5000);
+    }
+    int reserved = ht_capacity(ht);
+    int* many = malloc(20000 * sizeof(int));
+    j = 0;
+    for (i = 0; i < 20000; ++i){
+        many[i] = (i - 10000) * 3;
+        ht_insert(ht, &many[i], &many[i], convert_int);
+        if (ht_hash_func(ht, &many[i], convert_int) < 0)
+            j++;
+    }
+    printf("negative bucket indices, should be 0: %d...", j);
+    if (j != 0)
+        printf("FAIL\n");
+    else
+        printf("OK\n");
+    int grown = ht_capacity(ht);
+
+    for (i = 10; i < 20000; ++i)
+        ht_remove(ht, &many[i], convert_int);
+    j = 0;
+    for (i = 0; i < 20000; ++i){
+        elem_val = ht_lookup(ht, &many[i], convert_int);
+        if (i < 10 ? elem_val != &many[i] : elem_val != NULL)
+            j++;
+    }
+    printf("size should be 10: %d, wrong lookups should be 0: %d...", ht_size(ht), j);
+    if (ht_size(ht) != 10 || j != 0)
+        printf("FAIL\n");
+    else
+        printf("OK\n");
+    printf("capacity should shrink from %d back to the reserved %d: %d...",
+        grown, reserved, ht_capacity(ht));
+    if (ht_capacity(ht) != reserved || ht_capacity(ht) >= grown)
+        printf("FAIL\n");
+    else
+        printf("OK\n");
+    free(many);
+
+    /*
+     * Use the built-in string hasher, copies of a key should find the value
+     * stored under the original...
+     */
+    printf("\nInserting 1000 string keys with the built-in string hasher...\n");
+    ht_free(ht);
+    ht = ht_create_type(type);
+    ht_set_key_cmp(ht, cmp_str);
+    char (*names)[16] = malloc(1000 * sizeof(*names));
+    char query[16];
+    for (i = 0; i < 1000; ++i){
+        sprintf(names[i], "key-%d", i);
+        ht_insert(ht, names[i], names[i], ht_hash_string);
+    }
+    j = 0;
+    for (i = 0; i < 1000; ++i){
+        sprintf(query, "key-%d", i);
+        if (ht_lookup(ht, query, ht_hash_string) != names[i])
+            j++;
+    }
+    printf("size should be 1000: %d, wrong lookups should be 0: %d...", ht_size(ht), j);
+    if (ht_size(ht) != 1000 || j != 0)
+        printf("FAIL\n");
+    else
+        printf("OK\n");
+    free(names);
+
+    /*
+     * Two tables with the same fixed seed should put keys in the same buckets...
+     */
+    printf("\nChecking that tables with the same seed hash keys alike...\n");
+    struct ht* twin = ht_create_type(type);
+    ht_free(ht);
+    ht = ht_create_type(type);
+    ht_set_seed(ht, 42);
+    ht_set_seed(twin, 42);
+    j = 0;
+    for (i = 0; i < 1000; ++i){
+        if (ht_hash_func(ht, &i, ht_hash_int) != ht_hash_func(twin, &i, ht_hash_int))
+            j++;
+    }
+    printf("keys hashed differently, should be 0: %d...", j);
+    if (j != 0)
+        printf("FAIL\n");
+    else
+        printf("OK\n");
+    ht_free(twin);
+
+    /*
+     * Turn statistics on, they should count every lookup and the resizes
+     * the inserts caused...
+     */
+    printf("\nCollecting statistics over 1000 hits and 1000 misses...\n");
+    ht_free(ht);
+    ht = ht_create_type(type);
+    ht_enable_stats(ht, 1);
+    int* stat_keys = malloc(2000 * sizeof(int));
+    for (i = 0; i < 2000; ++i)
+        stat_keys[i] = i;
+    for (i = 0; i < 1000; ++i)
+        ht_insert(ht, &stat_keys[i], &stat_keys[i], convert_int);
+    for (i = 0; i < 2000; ++i)
+        ht_lookup(ht, &stat_keys[i], convert_int);
+    struct ht_stats stats;
+    ht_stats(ht, &stats);
+    printf("hits should be 1000: %ld, misses should be 1000: %ld, resizes: %ld...",
+        stats.hits, stats.misses, stats.resizes);
+    if (stats.hits != 1000 || stats.misses != 1000 || stats.resizes == 0
+            || stats.avg_probes_hit < 1 || stats.max_probes_hit < 1)
+        printf("FAIL\n");
+    else
+        printf("OK\n");
+
+    long binned = 0;
+    for (i = 0; i < HT_STATS_BINS; ++i)
+        binned += type == HT_CHAINING ? stats.occupancy[i] * i : stats.occupancy[i];
+    printf("occupancy histogram should account for 1000 entries: %ld...", binned);
+    if (binned != 1000)
+        printf("FAIL\n");
+    else
+        printf("OK\n");
+
+    /*
+     * A table with few enough entries keeps them inline, a chained one
+     * should report them as a single bucket...
+     */
+    ht_free(ht);
+    ht = ht_create_type(type);
+    for (i = 0; i < 5; ++i)
+        ht_insert(ht, &stat_keys[i], &stat_keys[i], convert_int);
+    ht_stats(ht, &stats);
+    binned = 0;
+    for (i = 0; i < HT_STATS_BINS; ++i)
+        binned += type == HT_CHAINING ? stats.occupancy[i] * i : stats.occupancy[i];
+    printf("histogram of 5 inline entries should account for 5 entries: %ld...", binned);
+    if (binned != 5 || (type == HT_CHAINING && (stats.occupancy[0] != 0 || stats.occupancy[5] != 1)))
+        printf("FAIL\n");
+    else
+        printf("OK\n");
+    free(stat_keys);
+
+    /*
+     * With the Bloom filter on, every key should still be found after the
+     * table grows, and removed keys should be gone after it shrinks...
+     */
+    printf("\nFiltering lookups with a Bloom filter...\n");
+    ht_free(ht);
+    ht = ht_create_type(type);
+    ht_enable_bloom(ht, 1);
+    int* bloom_keys = malloc(20000 * sizeof(int));
+    for (i = 0; i < 20000; ++i)
+        bloom_keys[i] = i;
+    for (i = 0; i < 10000; ++i)
+        ht_insert(ht, &bloom_keys[i], &bloom_keys[i], convert_int);
+    j = 0;
+    for (i = 0; i < 20000; ++i)
+        if ((ht_lookup(ht, &bloom_keys[i], convert_int) != NULL) != (i < 10000))
+            j++;
+    printf("wrong lookups, should be 0: %d...", j);
+    if (j != 0)
+        printf("FAIL\n");
+    else
+        printf("OK\n");
+
+    for (i = 0; i < 9990; ++i)
+        ht_remove(ht, &bloom_keys[i], convert_int);
+    for (i = 10000; i < 20000; ++i)
+        ht_insert(ht, &bloom_keys[i], &bloom_keys[i], convert_int);
+    j = 0;
+    for (i = 0; i < 20000; ++i)
+        if ((ht_lookup(ht, &bloom_keys[i], convert_int) != NULL) != (i >= 9990))
+            j++;
+    printf("wrong lookups after removing and reinserting, should be 0: %d...", j);
+    if (j != 0)
+        printf("FAIL\n");
+    else
+        printf("OK\n");
+
+    /*
+     * A chained table fills its new filter a few buckets per call after a
+     * resize, so no single insert or remove should add every key to it...
+     */
+    if (type == HT_CHAINING){
+        ht_free(ht);
+        ht = ht_create_type(type);
+        ht_enable_stats(ht, 1);
+        ht_enable_bloom(ht, 1);
+        for (i = 0; i < 20000; ++i)
+            ht_insert(ht, &bloom_keys[i], &bloom_keys[i], convert_int);
+        for (i = 0; i < 19000; ++i)
+            ht_remove(ht, &bloom_keys[i], convert_int);
+        j = 0;
+        for (i = 0; i < 20000; ++i)
+            if ((ht_lookup(ht, &bloom_keys[i], convert_int) != NULL) != (i >= 19000))
+                j++;
+        ht_stats(ht, &stats);
+        printf("most keys one call added to the filter, should be well under 20000: %d,"
+            " wrong lookups should be 0: %d...", stats.max_filter_adds, j);
+        if (stats.max_filter_adds < 1 || stats.max_filter_adds > 200 || j != 0)
+            printf("FAIL\n");
+        else
+            printf("OK\n");
+    }
+    free(bloom_keys);
+
+    /*
+     * With resize threads, large resizes move every bucket at once on four
+     * threads, growing and shrinking should not lose a key...
+     */
+    printf("\nResizing on 4 threads...\n");
+    ht_free(ht);
+    ht = ht_create_type(type);
+    ht_set_resize_threads(ht, 4);
+    int* par_keys = malloc(200000 * sizeof(int));
+    for (i = 0; i < 200000; ++i)
+        par_keys[i] = i;
+    for (i = 0; i < 200000; ++i)
+        ht_insert(ht, &par_keys[i], &par_keys[i], convert_int);
+    j = 0;
+    for (i = 0; i < 200000; ++i)
+        if (ht_lookup(ht, &par_keys[i], convert_int) != &par_keys[i])
+            j++;
+    printf("keys not found, should be 0: %d...", j);
+    if (j != 0 || ht_size(ht) != 200000)
+        printf("FAIL\n");
+    else
+        printf("OK\n");
+    int par_grown = ht_capacity(ht);
+
+    for (i = 10; i < 200000; ++i)
+        ht_remove(ht, &par_keys[i], convert_int);
+    j = 0;
+    for (i = 0; i < 200000; ++i)
+        if ((ht_lookup(ht, &par_keys[i], convert_int) != NULL) != (i < 10))
+            j++;
+    printf("wrong lookups after shrinking, should be 0: %d, capacity should drop below %d: %d...",
+        j, par_grown, ht_capacity(ht));
+    if (j != 0 || ht_size(ht) != 10 || ht_capacity(ht) >= par_grown)
+        printf("FAIL\n");
+    else
+        printf("OK\n");
+    free(par_keys);
+
+    /*
+     * Scan a table 16 entries at a time while inserting keys that make it
+     * grow and then removing them again so it shrinks, every key that stays
+     * in the table the whole time should be returned.  A scan bucket that
+     * does not fit 16 entries is read again with a larger batch...
+     */
+    printf("\nScanning while the table grows and shrinks...\n");
+    ht_free(ht);
+    ht = ht_create_type(type);
+    int* scan_keys = malloc(20000 * sizeof(int));
+    char* seen = calloc(20000, 1);
+    struct ht_entry batch[256];
+    unsigned int cursor = 0;
+    int calls = 0, got;
+    for (i = 0; i < 20000; ++i)
+        scan_keys[i] = i;
+    for (i = 0; i < 1000; ++i)
+        ht_insert(ht, &scan_keys[i], &scan_keys[i], convert_int);
+    do {
+        got = ht_scan(ht, &cursor, 16, batch);
+        if (got < 0)
+            got = ht_scan(ht, &cursor, -got, batch);
+        for (j = 0; j < got; ++j)
+            seen[*(int*)batch[j].key] = 1;
+        // grow to 20000 keys over the first 100 calls, then shrink back
+        for (j = 0; j < 190; ++j){
+            int k = 1000 + (calls * 190 + j) % 19000;
+            if (calls < 100)
+                ht_insert(ht, &scan_keys[k], &scan_keys[k], convert_int);
+            else
+                ht_remove(ht, &scan_keys[k], convert_int);
+        }
+        calls++;
+    } while (cursor != 0 && got >= 0);
+    j = 0;
+    for (i = 0; i < 1000; ++i)
+        if (!seen[i])
+            j++;
+    printf("keys missed by the scan, should be 0: %d (in %d calls)...", j, calls);
+    if (j != 0 || got < 0)
+        printf("FAIL\n");
+    else
+        printf("OK\n");
+
+    /*
+     * 100 keys that share a hash code fall into one scan bucket, which does
+     * not fit a batch of 16...
+     */
+    ht_free(ht);
+    ht = ht_create_type(type);
+    ht_set_key_cmp(ht, cmp_int);
+    for (i = 0; i < 100; ++i){
+        scan_keys[i] = i * 4;
+        ht_insert(ht, &scan_keys[i], &scan_keys[i], convert_mod);
+    }
+    cursor = 0;
+    do {
+        got = ht_scan(ht, &cursor, 16, batch);
+    } while (got >= 0 && cursor != 0);
+    printf("a full bucket should ask for room for 100 entries: %d...", -got);
+    if (got != -100)
+        printf("FAIL\n");
+    else
+        printf("OK\n");
+    free(scan_keys);
+    free(seen);
+
+    /*
+     * Upserting every key of a stream counts how often each key occurs.  Key
+     * i appears i % 7 + 1 times, in a stream long enough to make the table
+     * grow, and the batch version should count the same...
+     */
+    printf("\nCounting keys with upserts...\n");
+    ht_free(ht);
+    ht = ht_create_type(type);
+    int* up_keys = malloc(5000 * sizeof(int));
+    void** stream = malloc(5000 * 7 * sizeof(void*));
+    int len = 0;
+    for (i = 0; i < 5000; ++i)
+        up_keys[i] = i;
+    for (j = 0; j < 7; ++j)
+        for (i = 0; i < 5000; ++i)
+            if (i % 7 >= j)
+                stream[len++] = &up_keys[i];
+    for (i = 0; i < len; ++i)
+        ht_upsert(ht, stream[i], convert_int, count_init, count_update, NULL);
+    j = 0;
+    for (i = 0; i < 5000; ++i)
+        if ((intptr_t)ht_lookup(ht, &up_keys[i], convert_int) != i % 7 + 1)
+            j++;
+    printf("wrong counts, should be 0: %d, size should be 5000: %d...", j, ht_size(ht));
+    if (j != 0 || ht_size(ht) != 5000)
+        printf("FAIL\n");
+    else
+        printf("OK\n");
+
+    ht_free(ht);
+    ht = ht_create_type(type);
+    ht_upsert_batch(ht, stream, NULL, len, convert_int, count_init, count_update);
+    j = 0;
+    for (i = 0; i < 5000; ++i)
+        if ((intptr_t)ht_lookup(ht, &up_keys[i], convert_int) != i % 7 + 1)
+            j++;
+    printf("wrong counts from a batch, should be 0: %d...", j);
+    if (j != 0 || ht_size(ht) != 5000)
+        printf("FAIL\n");
+    else
+        printf("OK\n");
+    free(up_keys);
+    free(stream);
+
+    /*
+     * A new table keeps its first 8 entries inline.  Colliding keys should
+     * be told apart there, and the 9th key should move every entry into the
+     * storage engine...
+     */
+    printf("\nKeeping small tables inline...\n");
+    ht_free(ht);
+    ht = ht_create_type(type);
+    ht_set_key_cmp(ht, cmp_int);
+    int small_keys[9];
+    for (i = 0; i < 9; ++i)
+        small_keys[i] = i * 4;
+    for (i = 0; i < 8; ++i)
+        ht_insert(ht, &small_keys[i], &small_keys[i], convert_mod);
+    ht_remove(ht, &small_keys[3], convert_mod);
+    ht_insert(ht, &small_keys[3], &small_keys[3], convert_mod);
+    j = 0;
+    for (i = 0; i < 8; ++i)
+        if (ht_lookup(ht, &small_keys[i], convert_mod) != &small_keys[i])
+            j++;
+    printf("keys not found, should be 0: %d, capacity should be 8: %d...", j, ht_capacity(ht));
+    if (j != 0 || ht_size(ht) != 8 || ht_capacity(ht) != 8)
+        printf("FAIL\n");
+    else
+        printf("OK\n");
+
+    ht_insert(ht, &small_keys[8], &small_keys[8], convert_mod);
+    j = 0;
+    for (i = 0; i < 9; ++i)
+        if (ht_lookup(ht, &small_keys[i], convert_mod) != &small_keys[i])
+            j++;
+    printf("keys not found after the 9th insert, should be 0: %d, size should be 9: %d...",
+        j, ht_size(ht));
+    if (j != 0 || ht_size(ht) != 9 || ht_capacity(ht) == 8)
+        printf("FAIL\n");
+    else
+        printf("OK\n");
+
     printf("\n\nCheck valgrind for memory leaks...\n");
 
     ht_free(ht);
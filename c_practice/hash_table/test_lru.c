@@ -0,0 +1,120 @@
+/*
+ * This is a small program to test the LRU cache.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "lru.h"
+
+/*
+ * This is a convert function to be used to convert the integer key
+ */
+int convert_int(void* key){
+    int *k = key;
+    return *k;
+}
+
+/*
+ * This eviction function records the key of every evicted entry.
+ */
+int evicted[1000];
+int num_evicted = 0;
+
+void record_evict(void* arg, void* key, void* value){
+    int* count = arg;
+    evicted[num_evicted++] = *(int*)key;
+    (*count)++;
+}
+
+int main(int argc, char** argv){
+    int keys[1000];
+    int calls = 0, i, j;
+    struct lru_stats stats;
+
+    for (i = 0; i < 1000; ++i)
+        keys[i] = i;
+
+    /*
+     * Fill a cache of 3 entries, touch the oldest one and add a fourth key,
+     * the second key should be the one evicted...
+     */
+    printf("Evicting the least recently used key...\n");
+    struct lru* c = lru_create(3, convert_int);
+    lru_set_evict(c, record_evict, &calls);
+    lru_put(c, &keys[1], &keys[1]);
+    lru_put(c, &keys[2], &keys[2]);
+    lru_put(c, &keys[3], &keys[3]);
+    lru_get(c, &keys[1]);
+    lru_put(c, &keys[4], &keys[4]);
+    printf("evicted key should be 2: %d, size should be 3: %d...",
+        num_evicted ? evicted[0] : -1, lru_size(c));
+    if (num_evicted != 1 || evicted[0] != 2 || lru_size(c) != 3
+            || lru_get(c, &keys[2]) != NULL || lru_get(c, &keys[1]) != &keys[1])
+        printf("FAIL\n");
+    else
+        printf("OK\n");
+
+    /*
+     * Updating a cached key replaces its value and touches it without
+     * evicting anything...
+     */
+    printf("\nUpdating a cached key...\n");
+    lru_put(c, &keys[3], &keys[30]);
+    lru_put(c, &keys[5], &keys[5]);
+    printf("evicted key should be 4: %d...", evicted[num_evicted - 1]);
+    if (num_evicted != 2 || evicted[1] != 4 || lru_get(c, &keys[3]) != &keys[30])
+        printf("FAIL\n");
+    else
+        printf("OK\n");
+
+    /*
+     * Removing a key frees its slot and is not an eviction...
+     */
+    printf("\nRemoving a key...\n");
+    lru_remove(c, &keys[1]);
+    lru_put(c, &keys[6], &keys[6]);
+    printf("size should be 3: %d, evictions should stay 2: %d...", lru_size(c), calls);
+    if (lru_size(c) != 3 || calls != 2 || lru_get(c, &keys[1]) != NULL)
+        printf("FAIL\n");
+    else
+        printf("OK\n");
+
+    lru_stats(c, &stats);
+    printf("hits should be 3: %ld, misses should be 2: %ld, evictions should be 2: %ld...",
+        stats.hits, stats.misses, stats.evictions);
+    if (stats.hits != 3 || stats.misses != 2 || stats.evictions != 2)
+        printf("FAIL\n");
+    else
+        printf("OK\n");
+    lru_free(c);
+
+    /*
+     * Cycle 1000 keys through a cache of 100, exactly the last 100 keys
+     * should be left, evicted in insertion order...
+     */
+    printf("\nCycling 1000 keys through 100 entries...\n");
+    num_evicted = 0;
+    calls = 0;
+    c = lru_create(100, convert_int);
+    lru_set_evict(c, record_evict, &calls);
+    for (i = 0; i < 1000; ++i)
+        lru_put(c, &keys[i], &keys[i]);
+    j = 0;
+    for (i = 0; i < 1000; ++i)
+        if ((lru_get(c, &keys[i]) != NULL) != (i >= 900))
+            j++;
+    for (i = 0; i < num_evicted; ++i)
+        if (evicted[i] != i)
+            j++;
+    printf("wrong keys, should be 0: %d, evictions should be 900: %d...", j, calls);
+    if (j != 0 || calls != 900)
+        printf("FAIL\n");
+    else
+        printf("OK\n");
+    lru_free(c);
+
+    printf("\n\nCheck valgrind for memory leaks...\n");
+
+    return 0;
+}
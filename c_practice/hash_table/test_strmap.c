@@ -0,0 +1,96 @@
+/*
+ * This is a small program to test the string map.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "strmap.h"
+
+int main(int argc, char** argv){
+    enum ht_type types[] = {HT_CHAINING, HT_ROBIN_HOOD, HT_SWISS};
+    const char* names[] = {"chaining", "robin_hood", "swiss"};
+    const int n = 100000;
+    char buf[64];
+    int values[16];
+    int i, j;
+
+    for (i = 0; i < 16; ++i)
+        values[i] = i;
+
+    for (int t = 0; t < 3; ++t){
+        struct strmap* m = strmap_create(types[t]);
+
+        /*
+         * Keys that only differ after a NUL byte, or by length, are
+         * different keys, and the map keeps its own copy of every key...
+         */
+        printf("\nStoring string keys in %s tables...\n", names[t]);
+        memcpy(buf, "ab\0cd", 6);
+        strmap_put(m, buf, 5, &values[1]);
+        strmap_put(m, buf, 2, &values[2]);
+        strmap_put(m, "", 0, &values[3]);
+        buf[4] = 'x';
+        printf("values should be 1 2 3 and missing: %d %d %d %s...",
+            *(int*)strmap_get(m, "ab\0cd", 5), *(int*)strmap_get(m, "ab", 2),
+            *(int*)strmap_get(m, "", 0), strmap_get(m, buf, 5) ? "found" : "missing");
+        if (strmap_get(m, "ab\0cd", 5) != &values[1] || strmap_get(m, "ab", 2) != &values[2]
+                || strmap_get(m, "", 0) != &values[3] || strmap_get(m, buf, 5) != NULL
+                || strmap_size(m) != 3)
+            printf("FAIL\n");
+        else
+            printf("OK\n");
+
+        /*
+         * Interning equal strings gives back the same copy, and putting a
+         * key that is already interned does not copy it again...
+         */
+        const char* a = strmap_intern(m, "interned", 8);
+        size_t bytes = strmap_arena_bytes(m);
+        strcpy(buf, "interned");
+        const char* b = strmap_intern(m, buf, 8);
+        const char* c = strmap_put(m, buf, 8, &values[4]);
+        printf("copies should be equal: %s, value should be 4: %d...",
+            a == b && b == c ? "equal" : "different", *(int*)strmap_get(m, a, 8));
+        if (a != b || b != c || a == buf || strcmp(a, "interned") != 0
+                || strmap_arena_bytes(m) != bytes || strmap_size(m) != 4)
+            printf("FAIL\n");
+        else
+            printf("OK\n");
+
+        /*
+         * Many keys, a key longer than an arena chunk and removals...
+         */
+        for (i = 0; i < n; ++i){
+            int len = sprintf(buf, "key-%d", i);
+            strmap_put(m, buf, len, &values[i % 16]);
+        }
+        char* big = malloc(100000);
+        memset(big, 'z', 100000);
+        strmap_put(m, big, 100000, &values[5]);
+        for (i = 0; i < n; i += 2){
+            int len = sprintf(buf, "key-%d", i);
+            strmap_remove(m, buf, len);
+        }
+        j = 0;
+        for (i = 0; i < n; ++i){
+            int len = sprintf(buf, "key-%d", i);
+            if (strmap_get(m, buf, len) != (i % 2 ? &values[i % 16] : NULL))
+                j++;
+        }
+        printf("wrong lookups, should be 0: %d, size should be %d: %d...", j, n / 2 + 5,
+            strmap_size(m));
+        if (j != 0 || strmap_size(m) != n / 2 + 5 || strmap_get(m, big, 100000) != &values[5]
+                || strmap_get(m, big, 99999) != NULL)
+            printf("FAIL\n");
+        else
+            printf("OK\n");
+        free(big);
+        strmap_free(m);
+    }
+
+    printf("\n\nCheck valgrind for memory leaks...\n");
+
+    return 0;
+}
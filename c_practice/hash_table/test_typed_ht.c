@@ -0,0 +1,105 @@
+/*
+ * This is a small program to test the tables generated by typed_ht.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "typed_ht.h"
+
+/*
+ * A table from int keys to int values, and a table from string keys to
+ * int values that brings its own hash and equality functions.
+ */
+DEFINE_INT_HT(int_ht, int)
+
+static inline uint32_t hash_str(const char* s){
+    uint32_t h = 2166136261u;
+    while (*s)
+        h = (h ^ (unsigned char)*s++) * 16777619u;
+    return typed_ht_hash_int((int32_t)h);
+}
+
+static inline int eq_str(const char* a, const char* b){
+    return strcmp(a, b) == 0;
+}
+
+DEFINE_HT(str_ht, const char*, int, hash_str, eq_str)
+
+int main(int argc, char** argv){
+    int i, j;
+
+    /*
+     * Insert 10000 keys, every one should be found with its value and none
+     * of the keys that were never inserted should be...
+     */
+    printf("Inserting 10000 int keys...\n");
+    struct int_ht* t = int_ht_create();
+    for (i = 0; i < 10000; ++i)
+        int_ht_insert(t, i * 7, i);
+    j = 0;
+    for (i = 0; i < 10000; ++i){
+        int* v = int_ht_lookup(t, i * 7);
+        if (v == NULL || *v != i || int_ht_lookup(t, i * 7 + 1) != NULL)
+            j++;
+    }
+    printf("wrong lookups, should be 0: %d, size should be 10000: %d...", j, int_ht_size(t));
+    if (j != 0 || int_ht_size(t) != 10000)
+        printf("FAIL\n");
+    else
+        printf("OK\n");
+
+    /*
+     * Insert an existing key again, its value should be replaced...
+     */
+    printf("\nReplacing a value...\n");
+    int_ht_insert(t, 70, -1);
+    printf("value should be -1: %d, size should stay 10000: %d...",
+        *int_ht_lookup(t, 70), int_ht_size(t));
+    if (*int_ht_lookup(t, 70) != -1 || int_ht_size(t) != 10000)
+        printf("FAIL\n");
+    else
+        printf("OK\n");
+
+    /*
+     * Remove all but 10 keys, the table should shrink back and still find
+     * the keys that are left...
+     */
+    printf("\nRemoving 9990 keys...\n");
+    for (i = 0; i < 9990; ++i)
+        int_ht_remove(t, i * 7);
+    j = 0;
+    for (i = 0; i < 10000; ++i)
+        if ((int_ht_lookup(t, i * 7) != NULL) != (i >= 9990))
+            j++;
+    printf("wrong lookups, should be 0: %d, capacity should be 128 or less: %d...",
+        j, int_ht_capacity(t));
+    if (j != 0 || int_ht_size(t) != 10 || int_ht_capacity(t) > 128)
+        printf("FAIL\n");
+    else
+        printf("OK\n");
+    int_ht_free(t);
+
+    /*
+     * String keys are told apart by the table's equality function, not by
+     * their addresses...
+     */
+    printf("\nUsing string keys...\n");
+    struct str_ht* s = str_ht_create();
+    char buf[16];
+    str_ht_insert(s, "apple", 1);
+    str_ht_insert(s, "banana", 2);
+    strcpy(buf, "banana");
+    int* v = str_ht_lookup(s, buf);
+    printf("value of banana should be 2: %d...", v ? *v : -1);
+    if (v == NULL || *v != 2 || str_ht_lookup(s, "cherry") != NULL)
+        printf("FAIL\n");
+    else
+        printf("OK\n");
+    str_ht_free(s);
+
+    printf("\n\nCheck valgrind for memory leaks...\n");
+
+    return 0;
+}
@@ -0,0 +1,228 @@
+/*
+ * This file contains a hash table that is generated for one key type and
+ * one value type at compile time.  The tables behind hash_table.h store
+ * keys and values as void* and reach the key's hash code and equality
+ * through function pointers.  A table defined here stores keys and values
+ * inline in its slots and calls the hash and equality functions directly,
+ * so the compiler can inline them.  It uses the same Robin Hood linear
+ * probing as robin_hood.c.
+ *
+ * DEFINE_HT(name, key_type, value_type, hash_fn, eq_fn) defines
+ * `struct name` and the functions below, all `static inline`, so the macro
+ * can be used in every file that needs the table:
+ *
+ *   struct name* name_create()
+ *   void name_free(struct name* t)
+ *   int name_size(struct name* t)
+ *   int name_capacity(struct name* t)
+ *   void name_reserve(struct name* t, int n)
+ *   void name_insert(struct name* t, key_type key, value_type value)
+ *   value_type* name_lookup(struct name* t, key_type key)
+ *   void name_remove(struct name* t, key_type key)
+ *
+ * They behave like the ht_* functions of the same name, except that
+ * name_lookup() returns a pointer to the value stored in the table, or NULL
+ * if the key is not in it.  The pointer is valid until the next insert or
+ * remove.  `hash_fn(key)` must return a 32-bit hash code whose high bits
+ * are well mixed, and `eq_fn(a, b)` must return non-zero when two keys are
+ * equal.  DEFINE_INT_HT(name, value_type) defines a table with int32_t keys
+ * and the built-in typed_ht_hash_int and typed_ht_eq_int functions.
+ *
+ * Tables grow once they are 3/4 full and shrink once they are less than
+ * 1/8 full, down to the size they were created or reserved with.
+ */
+
+#ifndef __TYPED_HT_H
+#define __TYPED_HT_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <assert.h>
+
+/*
+ * Initial number of slots of a table and the number of hash bits dropped to
+ * turn a hash code into one of them.
+ */
+#define TYPED_HT_INIT_CAPACITY 8
+#define TYPED_HT_INIT_SHIFT 29
+
+/*
+ * This function scrambles an int key so that every bit of its hash code
+ * depends on every bit of the key, like hash_mix32() in hashers.c.
+ */
+static inline uint32_t typed_ht_hash_int(int32_t key) {
+    uint32_t x = (uint32_t)key;
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+/*
+ * This function returns non-zero if two int keys are equal.
+ */
+static inline int typed_ht_eq_int(int32_t a, int32_t b) {
+    return a == b;
+}
+
+#define DEFINE_HT(name, K, V, hash_fn, eq_fn)                                  \
+                                                                               \
+struct name##_slot {                                                           \
+    K key;                                                                     \
+    V value;                                                                   \
+    uint32_t hash;                                                             \
+    uint32_t dist;                                                             \
+};                                                                             \
+                                                                               \
+struct name {                                                                  \
+    struct name##_slot* slots;                                                 \
+    int capacity;                                                              \
+    int shift;                                                                 \
+    int size;                                                                  \
+    int min_capacity;                                                          \
+};                                                                             \
+                                                                               \
+static inline struct name##_slot* _##name##_alloc_slots(int capacity) {        \
+    struct name##_slot* slots = calloc(capacity, sizeof(struct name##_slot));  \
+    assert(slots);                                                             \
+    return slots;                                                              \
+}                                                                              \
+                                                                               \
+static inline struct name* name##_create() {                                   \
+    struct name* t = malloc(sizeof(struct name));                              \
+    assert(t);                                                                 \
+    t->slots = _##name##_alloc_slots(TYPED_HT_INIT_CAPACITY);                  \
+    t->capacity = TYPED_HT_INIT_CAPACITY;                                      \
+    t->shift = TYPED_HT_INIT_SHIFT;                                            \
+    t->size = 0;                                                               \
+    t->min_capacity = TYPED_HT_INIT_CAPACITY;                                  \
+    return t;                                                                  \
+}                                                                              \
+                                                                               \
+static inline void name##_free(struct name* t) {                               \
+    assert(t);                                                                 \
+    free(t->slots);                                                            \
+    free(t);                                                                   \
+}                                                                              \
+                                                                               \
+static inline int name##_size(struct name* t) {                                \
+    return t->size;                                                            \
+}                                                                              \
+                                                                               \
+static inline int name##_capacity(struct name* t) {                            \
+    return t->capacity;                                                        \
+}                                                                              \
+                                                                               \
+static inline void _##name##_place(struct name* t, struct name##_slot entry,   \
+        int idx) {                                                             \
+    int mask = t->capacity - 1;                                                \
+    while (t->slots[idx].dist != 0) {                                          \
+        if (t->slots[idx].dist < entry.dist) {                                 \
+            struct name##_slot tmp = t->slots[idx];                            \
+            t->slots[idx] = entry;                                             \
+            entry = tmp;                                                       \
+        }                                                                      \
+        idx = (idx + 1) & mask;                                                \
+        entry.dist++;                                                          \
+    }                                                                          \
+    t->slots[idx] = entry;                                                     \
+}                                                                              \
+                                                                               \
+static inline void _##name##_resize(struct name* t, int capacity) {            \
+    struct name##_slot* old = t->slots;                                        \
+    int old_cap = t->capacity;                                                 \
+    t->slots = _##name##_alloc_slots(capacity);                                \
+    t->capacity = capacity;                                                    \
+    t->shift = 32 - __builtin_ctz(capacity);                                   \
+    for (int i = 0; i < old_cap; i++) {                                        \
+        if (old[i].dist != 0) {                                                \
+            old[i].dist = 1;                                                   \
+            _##name##_place(t, old[i], (int)(old[i].hash >> t->shift));        \
+        }                                                                      \
+    }                                                                          \
+    free(old);                                                                 \
+}                                                                              \
+                                                                               \
+static inline void name##_reserve(struct name* t, int n) {                     \
+    assert(t && n >= 0);                                                       \
+    int capacity = TYPED_HT_INIT_CAPACITY;                                     \
+    while (n * 4 > capacity * 3) {                                             \
+        capacity *= 2;                                                         \
+    }                                                                          \
+    t->min_capacity = capacity;                                                \
+    if (capacity > t->capacity) {                                              \
+        _##name##_resize(t, capacity);                                         \
+    }                                                                          \
+}                                                                              \
+                                                                               \
+static inline void name##_insert(struct name* t, K key, V value) {             \
+    if ((t->size + 1) * 4 > t->capacity * 3) {                                 \
+        _##name##_resize(t, t->capacity * 2);                                  \
+    }                                                                          \
+    uint32_t hash = hash_fn(key);                                              \
+    int mask = t->capacity - 1;                                                \
+    int idx = (int)(hash >> t->shift);                                         \
+    uint32_t dist = 1;                                                         \
+    while (t->slots[idx].dist >= dist) {                                       \
+        if (t->slots[idx].hash == hash && eq_fn(t->slots[idx].key, key)) {     \
+            t->slots[idx].value = value;                                       \
+            return;                                                            \
+        }                                                                      \
+        idx = (idx + 1) & mask;                                                \
+        dist++;                                                                \
+    }                                                                          \
+    struct name##_slot entry;                                                  \
+    entry.key = key;                                                           \
+    entry.value = value;                                                       \
+    entry.hash = hash;                                                         \
+    entry.dist = dist;                                                         \
+    _##name##_place(t, entry, idx);                                            \
+    t->size++;                                                                 \
+}                                                                              \
+                                                                               \
+static inline int _##name##_find(struct name* t, K key) {                      \
+    uint32_t hash = hash_fn(key);                                              \
+    int mask = t->capacity - 1;                                                \
+    int idx = (int)(hash >> t->shift);                                         \
+    uint32_t dist = 1;                                                         \
+    while (t->slots[idx].dist >= dist) {                                       \
+        if (t->slots[idx].hash == hash && eq_fn(t->slots[idx].key, key)) {     \
+            return idx;                                                        \
+        }                                                                      \
+        idx = (idx + 1) & mask;                                                \
+        dist++;                                                                \
+    }                                                                          \
+    return -1;                                                                 \
+}                                                                              \
+                                                                               \
+static inline V* name##_lookup(struct name* t, K key) {                        \
+    int idx = _##name##_find(t, key);                                          \
+    return idx < 0 ? NULL : &t->slots[idx].value;                              \
+}                                                                              \
+                                                                               \
+static inline void name##_remove(struct name* t, K key) {                      \
+    int idx = _##name##_find(t, key);                                          \
+    if (idx < 0) {                                                             \
+        return;                                                                \
+    }                                                                          \
+    int mask = t->capacity - 1;                                                \
+    int next = (idx + 1) & mask;                                               \
+    while (t->slots[next].dist > 1) {                                          \
+        t->slots[idx] = t->slots[next];                                        \
+        t->slots[idx].dist--;                                                  \
+        idx = next;                                                            \
+        next = (next + 1) & mask;                                              \
+    }                                                                          \
+    t->slots[idx].dist = 0;                                                    \
+    t->size--;                                                                 \
+    if (t->size * 8 < t->capacity && t->capacity > t->min_capacity) {          \
+        _##name##_resize(t, t->capacity / 2);                                  \
+    }                                                                          \
+}
+
+#define DEFINE_INT_HT(name, V) \
+    DEFINE_HT(name, int32_t, V, typed_ht_hash_int, typed_ht_eq_int)
+
+#endif
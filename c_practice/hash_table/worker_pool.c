@@ -0,0 +1,172 @@
+/*
+ * This file contains a pool of worker threads.  The threads are started
+ * once, when the pool is created, and then sleep until a job is handed to
+ * the pool.  Every job is run by all threads at once, the thread that hands
+ * it over included, and each of them is told its index so it can pick its
+ * own part of the work.  See the documentation below for more information
+ * on the individual functions in this implementation.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include "worker_pool.h"
+
+/*
+ * This structure represents the whole pool.  `generation` counts the jobs
+ * handed to the pool, a worker runs the current job once it sees the count
+ * change.  `pending` counts the workers still running the current job.
+ */
+struct worker_pool {
+    pthread_t* workers;
+    int threads;
+    pthread_mutex_t lock;
+    pthread_cond_t job_ready;
+    pthread_cond_t job_done;
+    void (*fn)(void* arg, int idx, int threads);
+    void* arg;
+    long generation;
+    int pending;
+    int stopping;
+};
+
+/*
+ * This structure is handed to every background thread when it starts.
+ */
+struct wp_worker {
+    struct worker_pool* wp;
+    int idx;
+};
+
+/*
+ * Auxilliary function run by every background thread: wait for a job, run
+ * the thread's share of it and report back, until the pool is freed.
+ */
+static void* _wp_main(void* arg) {
+    struct wp_worker* self = arg;
+    struct worker_pool* wp = self->wp;
+    int idx = self->idx;
+    long seen = 0;
+    free(self);
+
+    pthread_mutex_lock(&wp->lock);
+    for (;;) {
+        while (wp->generation == seen && !wp->stopping) {
+            pthread_cond_wait(&wp->job_ready, &wp->lock);
+        }
+        if (wp->stopping) {
+            break;
+        }
+        seen = wp->generation;
+        pthread_mutex_unlock(&wp->lock);
+
+        wp->fn(wp->arg, idx, wp->threads);
+
+        pthread_mutex_lock(&wp->lock);
+        if (--wp->pending == 0) {
+            pthread_cond_signal(&wp->job_done);
+        }
+    }
+    pthread_mutex_unlock(&wp->lock);
+    return NULL;
+}
+
+/*
+ * This function starts a pool of `threads` workers and returns a pointer to
+ * it.  The thread that runs a job counts as one of them, so `threads - 1`
+ * background threads are started.
+ *
+ * Params:
+ *   threads - the number of threads that run every job.  Must be at least 1.
+ */
+struct worker_pool* wp_create(int threads) {
+    assert(threads >= 1);
+    struct worker_pool* wp = malloc(sizeof(struct worker_pool));
+    assert(wp);
+    wp->workers = malloc(threads * sizeof(pthread_t));
+    assert(wp->workers);
+    wp->threads = threads;
+    pthread_mutex_init(&wp->lock, NULL);
+    pthread_cond_init(&wp->job_ready, NULL);
+    pthread_cond_init(&wp->job_done, NULL);
+    wp->fn = NULL;
+    wp->arg = NULL;
+    wp->generation = 0;
+    wp->pending = 0;
+    wp->stopping = 0;
+
+    for (int i = 1; i < threads; i++) {
+        struct wp_worker* w = malloc(sizeof(struct wp_worker));
+        assert(w);
+        w->wp = wp;
+        w->idx = i;
+        int err = pthread_create(&wp->workers[i], NULL, _wp_main, w);
+        assert(err == 0);
+        (void)err;
+    }
+    return wp;
+}
+
+/*
+ * This function stops the background threads of a pool and frees it.  It
+ * may not be called while a job is running.
+ *
+ * Params:
+ *   wp - the pool to be destroyed.  May not be NULL.
+ */
+void wp_free(struct worker_pool* wp) {
+    assert(wp);
+    pthread_mutex_lock(&wp->lock);
+    wp->stopping = 1;
+    pthread_cond_broadcast(&wp->job_ready);
+    pthread_mutex_unlock(&wp->lock);
+    for (int i = 1; i < wp->threads; i++) {
+        pthread_join(wp->workers[i], NULL);
+    }
+    pthread_mutex_destroy(&wp->lock);
+    pthread_cond_destroy(&wp->job_ready);
+    pthread_cond_destroy(&wp->job_done);
+    free(wp->workers);
+    free(wp);
+}
+
+/*
+ * This function returns the number of threads that run every job.
+ */
+int wp_threads(struct worker_pool* wp) {
+    assert(wp);
+    return wp->threads;
+}
+
+/*
+ * This function runs a job on every thread of a pool and returns once all
+ * of them are done with it.  The calling thread runs share 0 itself.
+ * Everything the threads wrote is visible to the caller afterwards.
+ *
+ * Params:
+ *   wp - the pool that runs the job.  May not be NULL.
+ *   fn - called once on every thread with `arg`, the thread's index from 0
+ *     to `threads` - 1 and the number of threads.
+ *   arg - passed through to `fn`.
+ */
+void wp_run(struct worker_pool* wp, void (*fn)(void* arg, int idx, int threads), void* arg) {
+    assert(wp && fn);
+    pthread_mutex_lock(&wp->lock);
+    wp->fn = fn;
+    wp->arg = arg;
+    wp->pending = wp->threads - 1;
+    wp->generation++;
+    pthread_cond_broadcast(&wp->job_ready);
+    pthread_mutex_unlock(&wp->lock);
+
+    fn(arg, 0, wp->threads);
+
+    pthread_mutex_lock(&wp->lock);
+    while (wp->pending > 0) {
+        pthread_cond_wait(&wp->job_done, &wp->lock);
+    }
+    pthread_mutex_unlock(&wp->lock);
+}
@@ -0,0 +1,26 @@
+/*
+ * This file contains the definition of the interface for a fixed pool of
+ * worker threads that run one job at a time, each thread taking its own
+ * share of it.  Hash tables use it to move their buckets in parallel when
+ * they resize.  You can find descriptions of the functions, including their
+ * parameters and their return values, in worker_pool.c.
+ */
+
+#ifndef __WORKER_POOL_H
+#define __WORKER_POOL_H
+
+/*
+ * Structure used to represent a worker pool.
+ */
+struct worker_pool;
+
+/*
+ * Worker pool interface function prototypes.  Refer to worker_pool.c for
+ * documentation about each of these functions.
+ */
+struct worker_pool* wp_create(int threads);
+void wp_free(struct worker_pool* wp);
+int wp_threads(struct worker_pool* wp);
+void wp_run(struct worker_pool* wp, void (*fn)(void* arg, int idx, int threads), void* arg);
+
+#endif